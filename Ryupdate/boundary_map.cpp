@@ -0,0 +1,300 @@
+#include "boundary_map.hpp"
+#include "x86_decoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+boundary_map::boundary_map()
+	: image_size(0)
+{
+}
+
+boundary_map::boundary_map(const uint8_t *base, size_t size, const pe_image &image)
+	: image_size(size)
+{
+	//a chunk started at an arbitrary byte falls in step within a few instructions
+	const size_t chunk_size = 0x40000;
+
+	std::vector<uint64_t> swept((size + 63) / 64, 0);
+
+	for (const pe_image::section &s : image.get_sections())
+	{
+		size_t first = s.virtual_address, last = std::min(static_cast<size_t>(s.virtual_address) + s.virtual_size, size);
+		if (!s.executable || first >= last)
+		{
+			continue;
+		}
+
+		ranges.push_back(std::make_pair(first, last));
+
+		size_t count = (last - first + chunk_size - 1) / chunk_size;
+		std::vector<std::vector<uint64_t>> chunks(count);
+
+		size_t thread_count = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), count));
+		std::vector<std::thread> threads;
+
+		for (size_t t = 0; t < thread_count; ++t)
+		{
+			threads.push_back(std::thread([&, t]() {
+				for (size_t k = t; k < count; k += thread_count)
+				{
+					chunks.at(k) = sweep(base, first + k * chunk_size, std::min(first + (k + 1) * chunk_size, last), last);
+				}
+			}));
+		}
+
+		for (std::thread &thread : threads)
+		{
+			thread.join();
+		}
+
+		//until both chunks decoded an instruction at the same place
+		for (size_t k = 0; k < count; ++k)
+		{
+			size_t chunk_first = first + k * chunk_size, chunk_last = std::min(chunk_first + chunk_size, last);
+			size_t synced = chunk_first;
+
+			if (k != 0)
+			{
+				const std::vector<uint64_t> &previous = chunks.at(k - 1);
+				size_t previous_first = chunk_first - chunk_size;
+				size_t previous_last = std::min(previous_first + previous.size() * 64, chunk_last);
+
+				for (; synced < previous_last; ++synced)
+				{
+					bool before = test(previous, synced - previous_first);
+					if (before && test(chunks.at(k), synced - chunk_first))
+					{
+						break;
+					}
+
+					if (before)
+					{
+						set(swept, synced);
+					}
+				}
+			}
+
+			for (size_t n = synced; n < chunk_last; ++n)
+			{
+				if (test(chunks.at(k), n - chunk_first))
+				{
+					set(swept, n);
+				}
+			}
+		}
+	}
+
+	//calls land on function starts
+	std::vector<uint64_t> confirmed(swept.size(), 0), inside(swept.size(), 0);
+
+	for (const std::pair<size_t, size_t> &range : ranges)
+	{
+		for (size_t n = range.first; n + 5 <= range.second; ++n)
+		{
+			if (base[n] != 0xE8 || !test(swept, n))
+			{
+				continue;
+			}
+
+			int32_t rel = 0;
+			memcpy(&rel, base + n + 1, sizeof(rel));
+			size_t target = static_cast<size_t>(static_cast<int64_t>(n) + 5 + rel);
+
+			//a target the sweep missed needs padding in front of it
+			if (target < size && this->is_executable(target) && (test(swept, target) || (target != 0 && (base[target - 1] == 0xCC || base[target - 1] == 0xC3))))
+			{
+				this->follow(base, target, confirmed, inside);
+			}
+		}
+	}
+
+	starts.assign(swept.size(), 0);
+	for (size_t n = 0; n < starts.size(); ++n)
+	{
+		starts.at(n) = confirmed.at(n) | (swept.at(n) & ~inside.at(n));
+	}
+}
+
+boundary_map::~boundary_map()
+{
+}
+
+bool boundary_map::load(const std::string &path, uint64_t build)
+{
+	std::ifstream fs(path, std::ios::binary);
+	if (!fs.is_open())
+	{
+		return false;
+	}
+
+	uint64_t stored_build = 0, size = 0, range_count = 0;
+	fs.read(reinterpret_cast<char *>(&stored_build), sizeof(stored_build));
+	fs.read(reinterpret_cast<char *>(&size), sizeof(size));
+	fs.read(reinterpret_cast<char *>(&range_count), sizeof(range_count));
+
+	if (!fs || stored_build != build || range_count > 0x100)
+	{
+		return false;
+	}
+
+	std::vector<std::pair<size_t, size_t>> loaded_ranges;
+	for (uint64_t n = 0; n < range_count; ++n)
+	{
+		uint64_t range[2] = {0, 0};
+		fs.read(reinterpret_cast<char *>(range), sizeof(range));
+		loaded_ranges.push_back(std::make_pair(static_cast<size_t>(range[0]), static_cast<size_t>(range[1])));
+	}
+
+	std::vector<uint64_t> loaded(static_cast<size_t>((size + 63) / 64));
+	if (!loaded.empty())
+	{
+		fs.read(reinterpret_cast<char *>(loaded.data()), loaded.size() * sizeof(uint64_t));
+	}
+
+	if (!fs)
+	{
+		return false;
+	}
+
+	image_size = static_cast<size_t>(size);
+	ranges.swap(loaded_ranges);
+	starts.swap(loaded);
+
+	return true;
+}
+
+bool boundary_map::save(const std::string &path, uint64_t build) const
+{
+	std::ofstream fs(path, std::ios::binary | std::ios::trunc);
+	if (!fs.is_open())
+	{
+		return false;
+	}
+
+	uint64_t size = image_size, range_count = ranges.size();
+	fs.write(reinterpret_cast<const char *>(&build), sizeof(build));
+	fs.write(reinterpret_cast<const char *>(&size), sizeof(size));
+	fs.write(reinterpret_cast<const char *>(&range_count), sizeof(range_count));
+
+	for (const std::pair<size_t, size_t> &r : ranges)
+	{
+		uint64_t range[2] = {r.first, r.second};
+		fs.write(reinterpret_cast<const char *>(range), sizeof(range));
+	}
+
+	if (!starts.empty())
+	{
+		fs.write(reinterpret_cast<const char *>(starts.data()), starts.size() * sizeof(uint64_t));
+	}
+
+	return static_cast<bool>(fs);
+}
+
+bool boundary_map::is_boundary(size_t offset) const
+{
+	if (offset >= image_size || !this->is_executable(offset))
+	{
+		return true;
+	}
+
+	return test(starts, offset);
+}
+
+std::vector<uint64_t> boundary_map::sweep(const uint8_t *base, size_t first, size_t last, size_t end)
+{
+	//chains meet long before a page
+	end = std::min(end, last + 0x1000);
+
+	std::vector<uint64_t> bits((end - first + 63) / 64, 0);
+
+	for (size_t n = first; n < end;)
+	{
+		//invalid encodings are data
+		size_t length = get_length(base + n, end - n);
+		if (length != 0)
+		{
+			set(bits, n - first);
+		}
+
+		n += length != 0 ? length : 1;
+	}
+
+	return bits;
+}
+
+void boundary_map::follow(const uint8_t *base, size_t target, std::vector<uint64_t> &confirmed, std::vector<uint64_t> &inside) const
+{
+	std::vector<size_t> pending(1, target);
+
+	while (!pending.empty())
+	{
+		size_t n = pending.back();
+		pending.pop_back();
+
+		while (n < image_size && this->is_executable(n) && !test(confirmed, n) && !test(inside, n))
+		{
+			x86_decoder::instruction decoded = {};
+			size_t length = get_length(base + n, image_size - n);
+
+			if (length == 0)
+			{
+				break;
+			}
+
+			set(confirmed, n);
+			for (size_t k = 1; k < length; ++k)
+			{
+				set(inside, n + k);
+			}
+
+			uint8_t opcode = base[n];
+			bool branch = x86_decoder::decode(base + n, image_size - n, static_cast<uint32_t>(n), decoded) && decoded.op_count == 1 && decoded.operands[0].type == x86_decoder::operand::operand_imm;
+
+			//offsets stand in for addresses, branch targets come out as offsets
+			if (branch && (opcode == 0xE8 || opcode == 0xE9 || opcode == 0xEB || (opcode >= 0x70 && opcode <= 0x7F) || opcode == 0x0F))
+			{
+				pending.push_back(static_cast<size_t>(static_cast<uint32_t>(decoded.operands[0].imm)));
+			}
+
+			//nothing falls through returns, jmp and int3
+			if (opcode == 0xC3 || opcode == 0xC2 || opcode == 0xCC || opcode == 0xE9 || opcode == 0xEB || (opcode == 0xFF && ((base[n + 1] >> 3) & 7) == 4))
+			{
+				break;
+			}
+
+			n += length;
+		}
+	}
+}
+
+size_t boundary_map::get_length(const uint8_t *p, size_t size)
+{
+	//wait is an instruction of its own
+	return size != 0 && p[0] == 0x9B ? 1 : x86_decoder::get_length(p, size);
+}
+
+bool boundary_map::is_executable(size_t offset) const
+{
+	for (const std::pair<size_t, size_t> &range : ranges)
+	{
+		if (offset >= range.first && offset < range.second)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool boundary_map::test(const std::vector<uint64_t> &bits, size_t n)
+{
+	return (n / 64) < bits.size() && (bits[n / 64] >> (n % 64)) & 1;
+}
+
+void boundary_map::set(std::vector<uint64_t> &bits, size_t n)
+{
+	bits[n / 64] |= 1ull << (n % 64);
+}
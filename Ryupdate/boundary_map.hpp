@@ -0,0 +1,46 @@
+#pragma once
+#include "pe_image.hpp"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//instruction starts of the executable sections, swept and corrected along calls and jumps
+class boundary_map
+{
+public:
+	boundary_map();
+	boundary_map(const uint8_t *base, size_t size, const pe_image &image);
+	~boundary_map();
+
+	//only loaded for the same build
+	bool load(const std::string &path, uint64_t build);
+	bool save(const std::string &path, uint64_t build) const;
+
+	//offsets outside executable sections are never rejected
+	bool is_boundary(size_t offset) const;
+
+private:
+	//decodes past last until the chain of the following chunk is met
+	static std::vector<uint64_t> sweep(const uint8_t *base, size_t first, size_t last, size_t end);
+
+	//instructions reached from target replace what the sweep decoded
+	void follow(const uint8_t *base, size_t target, std::vector<uint64_t> &confirmed, std::vector<uint64_t> &inside) const;
+
+	//length of the instruction at p, 0 for invalid encodings
+	static size_t get_length(const uint8_t *p, size_t size);
+
+	bool is_executable(size_t offset) const;
+
+	static bool test(const std::vector<uint64_t> &bits, size_t n);
+	static void set(std::vector<uint64_t> &bits, size_t n);
+
+	size_t image_size;
+
+	//executable ranges, [first, second)
+	std::vector<std::pair<size_t, size_t>> ranges;
+
+	//one bit per byte of the image
+	std::vector<uint64_t> starts;
+};
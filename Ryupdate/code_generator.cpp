@@ -1,7 +1,5 @@
 #include "code_generator.hpp"
 
-//std::multimap
-#include <map>
 
 implementation::implementation()
 {
@@ -21,7 +19,7 @@ void implementation::write_line(const std::string &text)
 	write(text + "\n");
 }
 
-std::string implementation::get_code()
+const std::string &implementation::get_code() const
 {
 	return code;
 }
@@ -30,13 +28,14 @@ function::function(access_specifier access, const std::pair<std::string, std::st
 {
 	this->access = access;
 	this->decl = decl;
+	this->is_static = false;
 }
 
 function::~function()
 {
 }
 
-void function::insert_parameter(std::pair<std::string, std::string> &param)
+void function::insert_parameter(const std::pair<std::string, std::string> &param)
 {
 	parameters.push_back(param);
 }
@@ -46,6 +45,11 @@ void function::set_implementation(const implementation &impl)
 	this->impl = impl;
 }
 
+void function::set_static(bool is_static)
+{
+	this->is_static = is_static;
+}
+
 implementation &function::get_implementation()
 {
 	return impl;
@@ -66,33 +70,62 @@ function::access_specifier &function::get_access_specifier()
 	return this->access;
 }
 
+function::access_specifier function::get_access_specifier() const
+{
+	return this->access;
+}
+
+bool function::get_static()
+{
+	return this->is_static;
+}
+
 std::string function::get_header()
 {
-	std::stringstream argument;
-	for (size_t n = 0; n < parameters.size(); ++n)
-	{
-		argument << parameters.at(n).second << ' ' << parameters.at(n).first;
+	std::stringstream text;
+	write_header(text);
+	return text.str();
+}
+
+std::string function::get_source(const std::string class_name)
+{
+	std::stringstream text;
+	write_source(text, class_name);
+	return text.str();
+}
 
-		argument << (n + 1 != parameters.size()) ? ", " : ");";
+void function::write_header(std::ostream &os) const
+{
+	if (is_static)
+	{
+		os << "static ";
 	}
 
-	return decl.second + " " + decl.first + "(" + (parameters.size() == 0 ? ")" : argument.str());
+	os << decl.second << ' ' << decl.first;
+	write_parameters(os);
 }
 
-std::string function::get_source(const std::string class_name)
+void function::write_source(std::ostream &os, const std::string &class_name) const
 {
-	std::stringstream argument;
+	os << decl.second << ' ' << class_name << "::" << decl.first;
+	write_parameters(os);
+	os << "\n{\n"
+	   << impl.get_code() << "\n}\n";
+}
+
+void function::write_parameters(std::ostream &os) const
+{
+	os << '(';
 	for (size_t n = 0; n < parameters.size(); ++n)
 	{
-		argument << parameters.at(n).second << ' ' << parameters.at(n).first;
+		if (n != 0)
+		{
+			os << ", ";
+		}
 
-		argument << (n + 1 != parameters.size()) ? ", " : ");";
+		os << parameters.at(n).second << ' ' << parameters.at(n).first;
 	}
-	std::stringstream text;
-	text << decl.second << ' ' << class_name << "::" << decl.first << '(' << (parameters.size() == 0 ? ")" : argument.str());
-	text << "\n{\n"
-		 << impl.get_code() << "\n}\n";
-	return text.str();
+	os << ')';
 }
 
 code_generator::code_generator(const std::string &class_name, const implementation &constructor_impl, const implementation &destructor_impl)
@@ -121,6 +154,11 @@ void code_generator::insert_function(const function &func)
 	class_function.push_back(func);
 }
 
+void code_generator::insert_function(function &&func)
+{
+	class_function.push_back(std::move(func));
+}
+
 void code_generator::insert_field(access_specifier access, const std::string &name)
 {
 	class_field.push_back(std::make_pair(access, name));
@@ -129,34 +167,55 @@ void code_generator::insert_field(access_specifier access, const std::string &na
 std::string code_generator::get_header()
 {
 	std::stringstream header;
+	write_header(header);
+	return header.str();
+}
 
+std::string code_generator::get_source()
+{
+	std::stringstream source;
+	write_source(source);
+	return source.str();
+}
+
+void code_generator::write_header(std::ostream &os) const
+{
 	for (const std::string &src : include_header)
 	{
-		header << src << '\n';
+		os << src << '\n';
 	}
 
-	header << '\n';
+	os << '\n';
 
-	header << "class " << class_name << "\n{\n";
+	os << "class " << class_name << "\n{\n";
 
-	std::multimap<function::access_specifier, function> function_graph;
-	for (function &f : class_function)
+	//one pass over the members per access specifier, in declaration order
+	for (int32_t i = 1; i < 4; ++i)
 	{
-		function_graph.insert(std::make_pair(f.get_access_specifier(), f));
-	}
+		function::access_specifier function_access = static_cast<function::access_specifier>(i);
+		code_generator::access_specifier field_access = static_cast<code_generator::access_specifier>(i);
 
-	std::multimap<code_generator::access_specifier, std::string> field_graph;
-	for (const std::pair<access_specifier, std::string> &p : class_field)
-	{
-		field_graph.insert(p);
-	}
+		bool has_function = false;
+		for (const function &f : class_function)
+		{
+			if (f.get_access_specifier() == function_access)
+			{
+				has_function = true;
+				break;
+			}
+		}
 
-	for (int32_t i = 1; i < 4; ++i)
-	{
-		auto function_range = function_graph.equal_range(static_cast<function::access_specifier>(i));
-		auto field_range = field_graph.equal_range(static_cast<code_generator::access_specifier>(i));
+		bool has_field = false;
+		for (const std::pair<access_specifier, std::string> &p : class_field)
+		{
+			if (p.first == field_access)
+			{
+				has_field = true;
+				break;
+			}
+		}
 
-		if (function_range.first == function_range.second && field_range.first == field_range.second && i != 1)
+		if (!has_function && !has_field && i != 1)
 		{
 			continue;
 		}
@@ -164,59 +223,62 @@ std::string code_generator::get_header()
 		switch (i)
 		{
 		case 1:
-			header << "public:\n";
+			os << "public:\n";
 			//make constructor and destructor
 			{
-				header << '\t' << this->class_name << "();\n";
-				header << "\t~" << this->class_name << "();\n\n";
+				os << '\t' << this->class_name << "();\n";
+				os << "\t~" << this->class_name << "();\n\n";
 			}
 			break;
 		case 2:
-			header << "protected:\n";
+			os << "protected:\n";
 			break;
 		case 3:
-			header << "private:\n";
+			os << "private:\n";
 			break;
 		}
 
-		for (auto it = function_range.first; it != function_range.second; ++it)
+		for (const function &f : class_function)
 		{
-			header << '\t' << it->second.get_header() << ";\n";
+			if (f.get_access_specifier() == function_access)
+			{
+				os << '\t';
+				f.write_header(os);
+				os << ";\n";
+			}
 		}
 
-		header << '\n';
+		os << '\n';
 
-		for (auto it = field_range.first; it != field_range.second; ++it)
+		for (const std::pair<access_specifier, std::string> &p : class_field)
 		{
-			header << '\t' << it->second << ";\n";
+			if (p.first == field_access)
+			{
+				os << '\t' << p.second << ";\n";
+			}
 		}
 	}
 
-	header << "\n}\n";
-
-	return header.str();
+	os << "};\n";
 }
 
-std::string code_generator::get_source()
+void code_generator::write_source(std::ostream &os) const
 {
-	std::stringstream source;
-
 	for (const std::string &src : include_source)
 	{
-		source << src << '\n';
+		os << src << '\n';
 	}
-	source << '\n';
+	os << '\n';
 
-	source << this->class_name << "::" << this->class_name << "()\n{\n";
-	source << constructor.get_code() << "\n}\n\n";
+	os << this->class_name << "::" << this->class_name << "()\n{\n";
+	os << constructor.get_code() << "\n}\n\n";
 
-	source << this->class_name << "::~" << this->class_name << "()\n{";
-	source << destructor.get_code() << "\n}\n\n";
+	os << this->class_name << "::~" << this->class_name << "()\n{";
+	os << destructor.get_code() << "\n}\n\n";
 
-	for (function &func : class_function)
+	for (const function &func : class_function)
 	{
-		source << func.get_source(this->class_name) << '\n';
+		func.write_source(os, this->class_name);
+		os << '\n';
 	}
-
-	return source.str();
 }
@@ -3,6 +3,7 @@
 #include <vector>
 #include <memory>
 #include <sstream>
+#include <ostream>
 
 class implementation
 {
@@ -13,7 +14,7 @@ public:
 	void write(const std::string &text);
 	void write_line(const std::string &text);
 
-	std::string get_code();
+	const std::string &get_code() const;
 
 private:
 	std::string code;
@@ -34,21 +35,30 @@ public:
 	~function();
 
 	//arg is parameter name with parameter type
-	void insert_parameter(std::pair<std::string, std::string> &param);
+	void insert_parameter(const std::pair<std::string, std::string> &param);
 
 	void set_implementation(const implementation &impl);
+	void set_static(bool is_static);
 
 	implementation &get_implementation();
 	std::vector<std::pair<std::string, std::string>> &get_parameters();
 	std::pair<std::string, std::string> &get_decl();
 	access_specifier &get_access_specifier();
+	access_specifier get_access_specifier() const;
+	bool get_static();
 
 	std::string get_header();
 	std::string get_source(const std::string class_name);
 
+	void write_header(std::ostream &os) const;
+	void write_source(std::ostream &os, const std::string &class_name) const;
+
 private:
+	void write_parameters(std::ostream &os) const;
+
 	std::pair<std::string, std::string> decl;
 	access_specifier access;
+	bool is_static;
 
 	std::vector<std::pair<std::string, std::string>> parameters;
 	implementation impl;
@@ -72,11 +82,16 @@ public:
 	void set_destructor(const implementation &destructor_impl);
 
 	void insert_function(const function &func);
+	void insert_function(function &&func);
 	void insert_field(access_specifier access, const std::string &name);
 
 	std::string get_header();
 	std::string get_source();
 
+	//streaming variants, nothing is copied or buffered besides the stream itself
+	void write_header(std::ostream &os) const;
+	void write_source(std::ostream &os) const;
+
 	std::vector<std::string> include_header;
 	std::vector<std::string> include_source;
 
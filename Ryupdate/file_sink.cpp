@@ -0,0 +1,159 @@
+#define NOMINMAX
+
+#include "file_sink.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <windows.h>
+
+file_sink::file_sink(const std::string &file, size_t buffer_size)
+	: file(file), temporary_file(file + ".tmp"), buffer(buffer_size), compare_buffer(buffer_size), matched(0), is_changed(false), is_closed(false), failed(false)
+{
+	this->setp(buffer.data(), buffer.data() + buffer.size());
+
+	existing.open(file, std::ios::binary);
+	if (!existing.is_open() && !diverge())
+	{
+		failed = true;
+	}
+}
+
+file_sink::~file_sink()
+{
+	this->close();
+}
+
+bool file_sink::close()
+{
+	if (is_closed)
+	{
+		return !failed;
+	}
+
+	is_closed = true;
+
+	if (!flush())
+	{
+		failed = true;
+	}
+
+	//identical prefix, but the old file was longer
+	if (!is_changed && existing.is_open() && existing.peek() != std::ifstream::traits_type::eof())
+	{
+		if (!diverge())
+		{
+			failed = true;
+		}
+	}
+
+	existing.close();
+
+	if (!is_changed || failed)
+	{
+		if (output.is_open())
+		{
+			output.close();
+			DeleteFileA(temporary_file.c_str());
+		}
+
+		return !failed;
+	}
+
+	output.close();
+
+	if (!output || !MoveFileExA(temporary_file.c_str(), file.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		DeleteFileA(temporary_file.c_str());
+		failed = true;
+	}
+
+	return !failed;
+}
+
+bool file_sink::changed() const
+{
+	return is_changed;
+}
+
+file_sink::int_type file_sink::overflow(int_type c)
+{
+	if (!flush())
+	{
+		return traits_type::eof();
+	}
+
+	if (!traits_type::eq_int_type(c, traits_type::eof()))
+	{
+		*this->pptr() = traits_type::to_char_type(c);
+		this->pbump(1);
+	}
+
+	return traits_type::not_eof(c);
+}
+
+int file_sink::sync()
+{
+	return flush() ? 0 : -1;
+}
+
+bool file_sink::flush()
+{
+	size_t size = this->pptr() - this->pbase();
+	this->setp(buffer.data(), buffer.data() + buffer.size());
+
+	if (size == 0 || failed)
+	{
+		return !failed;
+	}
+
+	if (!is_changed)
+	{
+		existing.read(compare_buffer.data(), size);
+		if (static_cast<size_t>(existing.gcount()) == size && !memcmp(compare_buffer.data(), buffer.data(), size))
+		{
+			matched += size;
+			return true;
+		}
+
+		existing.clear();
+		if (!diverge())
+		{
+			failed = true;
+			return false;
+		}
+	}
+
+	output.write(buffer.data(), size);
+	return static_cast<bool>(output);
+}
+
+bool file_sink::diverge()
+{
+	output.open(temporary_file, std::ios::binary | std::ios::trunc);
+	if (!output.is_open())
+	{
+		return false;
+	}
+
+	//carry over the part that was identical so far
+	if (matched != 0)
+	{
+		existing.seekg(0, std::ios::beg);
+
+		for (size_t copied = 0; copied < matched;)
+		{
+			size_t chunk = std::min(matched - copied, compare_buffer.size());
+			existing.read(compare_buffer.data(), chunk);
+			if (static_cast<size_t>(existing.gcount()) != chunk)
+			{
+				return false;
+			}
+
+			output.write(compare_buffer.data(), chunk);
+			copied += chunk;
+		}
+	}
+
+	is_changed = true;
+	return static_cast<bool>(output);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+//buffered output file, the target is only replaced when the content differs
+class file_sink : public std::streambuf
+{
+public:
+	file_sink(const std::string &file, size_t buffer_size = 1 << 16);
+	~file_sink();
+
+	//false on io errors
+	bool close();
+
+	//true once the target has been (or is being) rewritten
+	bool changed() const;
+
+protected:
+	int_type overflow(int_type c) override;
+	int sync() override;
+
+private:
+	bool flush();
+	bool diverge();
+
+	std::string file;
+	std::string temporary_file;
+
+	std::vector<char> buffer;
+	std::vector<char> compare_buffer;
+
+	std::ifstream existing;
+	std::ofstream output;
+
+	//bytes confirmed identical to the existing file
+	size_t matched;
+	bool is_changed;
+	bool is_closed;
+	bool failed;
+};
@@ -0,0 +1,174 @@
+#include "function_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+function_index::function_index()
+{
+}
+
+function_index::function_index(const pe_image &image)
+{
+	for (const pe_image::runtime_function &f : image.get_runtime_functions())
+	{
+		functions.push_back({f.begin, f.end});
+	}
+
+	this->normalize();
+}
+
+function_index::function_index(const uint8_t *base, size_t size, const pe_image &image, const boundary_map &boundaries)
+{
+	for (const pe_image::section &s : image.get_sections())
+	{
+		size_t first = s.virtual_address, last = std::min(static_cast<size_t>(s.virtual_address) + s.virtual_size, size);
+		if (!s.executable || first >= last)
+		{
+			continue;
+		}
+
+		std::vector<uint32_t> starts;
+
+		for (size_t n = first; n < last; ++n)
+		{
+			//calls of decoded code name their target
+			if (base[n] == 0xE8 && n + 5 <= last && boundaries.is_boundary(n))
+			{
+				int32_t rel = 0;
+				memcpy(&rel, base + n + 1, sizeof(rel));
+				size_t target = static_cast<size_t>(static_cast<int64_t>(n) + 5 + rel);
+
+				if (target >= first && target < last && base[target] != 0xCC && boundaries.is_boundary(target))
+				{
+					starts.push_back(static_cast<uint32_t>(target));
+				}
+			}
+
+			if (n == first || base[n] == 0xCC || !boundaries.is_boundary(n))
+			{
+				continue;
+			}
+
+			//functions only reached through vtables start behind padding or an aligned return
+			bool padded = base[n - 1] == 0xCC && boundaries.is_boundary(n - 1);
+			bool returned = (base[n - 1] == 0xC3 && boundaries.is_boundary(n - 1)) || (n >= first + 3 && base[n - 3] == 0xC2 && boundaries.is_boundary(n - 3));
+
+			if ((padded || returned) && is_prologue(base + n, last - n))
+			{
+				starts.push_back(static_cast<uint32_t>(n));
+			}
+			else if (padded && n % 16 == 0 && n + 4 <= last)
+			{
+				//switch tables sit behind padding as well, their entries point into the image
+				uint32_t value = 0;
+				memcpy(&value, base + n, sizeof(value));
+
+				if (value - static_cast<uint32_t>(reinterpret_cast<uintptr_t>(base)) >= size)
+				{
+					starts.push_back(static_cast<uint32_t>(n));
+				}
+			}
+		}
+
+		std::sort(starts.begin(), starts.end());
+		starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+		//a function runs until the next one, without the padding in front of it
+		for (size_t k = 0; k < starts.size(); ++k)
+		{
+			size_t end = k + 1 < starts.size() ? starts.at(k + 1) : last;
+			while (end > starts.at(k) + 1 && base[end - 1] == 0xCC)
+			{
+				--end;
+			}
+
+			functions.push_back({starts.at(k), static_cast<uint32_t>(end)});
+		}
+	}
+
+	this->normalize();
+}
+
+function_index::~function_index()
+{
+}
+
+const std::vector<function_index::function> &function_index::get_functions() const
+{
+	return functions;
+}
+
+const function_index::function *function_index::find(size_t offset) const
+{
+	auto it = std::upper_bound(functions.begin(), functions.end(), offset, [](size_t value, const function &f) { return value < f.begin; });
+	if (it == functions.begin())
+	{
+		return nullptr;
+	}
+
+	--it;
+	return offset < it->end ? &*it : nullptr;
+}
+
+bool function_index::is_start(size_t offset) const
+{
+	auto it = std::lower_bound(functions.begin(), functions.end(), offset, [](const function &f, size_t value) { return f.begin < value; });
+	return it != functions.end() && it->begin == offset;
+}
+
+bool function_index::is_prologue(const uint8_t *p, size_t size)
+{
+	if (size < 6)
+	{
+		return false;
+	}
+
+	//push ebp / mov ebp, esp, behind mov edi, edi for hotpatchable functions
+	if ((p[0] == 0x55 && p[1] == 0x8B && p[2] == 0xEC) || (p[0] == 0x8B && p[1] == 0xFF && p[2] == 0x55 && p[3] == 0x8B && p[4] == 0xEC))
+	{
+		return true;
+	}
+
+	//push -1 or -2 / push handler of seh frames, sub esp
+	if ((p[0] == 0x6A && p[2] == 0x68) || ((p[0] == 0x83 || p[0] == 0x81) && p[1] == 0xEC))
+	{
+		return true;
+	}
+
+	//callee saved pushes, or arguments read without a frame
+	if ((p[0] == 0x53 || p[0] == 0x56 || p[0] == 0x57) && ((p[1] >= 0x50 && p[1] <= 0x57) || p[1] == 0x8B))
+	{
+		return true;
+	}
+
+	if (p[0] == 0x8B && (p[1] & 0xC7) == 0x44 && p[2] == 0x24)
+	{
+		return true;
+	}
+
+	//mov eax, size / call __chkstk of large frames
+	return p[0] == 0xB8 && p[5] == 0xE8;
+}
+
+void function_index::normalize()
+{
+	std::sort(functions.begin(), functions.end(), [](const function &a, const function &b) { return a.begin < b.begin || (a.begin == b.begin && a.end > b.end); });
+
+	std::vector<function> normalized;
+	for (const function &f : functions)
+	{
+		if (f.begin >= f.end || (!normalized.empty() && normalized.back().begin == f.begin))
+		{
+			continue;
+		}
+
+		if (!normalized.empty() && normalized.back().end > f.begin)
+		{
+			normalized.back().end = f.begin;
+		}
+
+		normalized.push_back(f);
+	}
+
+	functions.swap(normalized);
+}
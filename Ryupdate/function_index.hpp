@@ -0,0 +1,45 @@
+#pragma once
+#include "pe_image.hpp"
+#include "boundary_map.hpp"
+
+#include <cstdint>
+#include <vector>
+
+//function extents sorted by start, from .pdata or guessed for x86
+class function_index
+{
+public:
+	struct function
+	{
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	function_index();
+
+	//x64 images, their runtime functions
+	explicit function_index(const pe_image &image);
+
+	//x86 images
+	function_index(const uint8_t *base, size_t size, const pe_image &image, const boundary_map &boundaries);
+
+	~function_index();
+
+	//sorted by begin, extents do not overlap
+	const std::vector<function> &get_functions() const;
+
+	//function holding offset, nullptr between functions
+	const function *find(size_t offset) const;
+
+	//true if a function starts at offset
+	bool is_start(size_t offset) const;
+
+private:
+	//openings msvc puts at the start of x86 functions
+	static bool is_prologue(const uint8_t *p, size_t size);
+
+	//sorts, drops duplicates and cuts overlapping extents
+	void normalize();
+
+	std::vector<function> functions;
+};
@@ -2,6 +2,8 @@
 #include "aobscan.hpp"
 #include "json.hpp"
 #include "signature_export.hpp"
+#include "signature_blob.hpp"
+#include "scan_context.hpp"
 #include "ryupdate.hpp"
 
 #include <functional>
@@ -20,6 +22,7 @@
 #include <QStatusBar>
 #include <QStandardPaths>
 #include <QHeaderView>
+#include <QScrollBar>
 #include <QComboBox>
 #include <QLineEdit>
 #include <QSpinBox>
@@ -40,7 +43,13 @@ mainwindow::mainwindow()
 	: table_widget(std::make_unique<QTableWidget>(this)),
 	  status_label(std::make_unique<QLabel>(this)),
 	  progress_bar(std::make_unique<QProgressBar>(this)),
-	  settings(std::make_unique<settingswindow>(this))
+	  settings(std::make_unique<settingswindow>(this)),
+	  scheduler(std::make_unique<scan_scheduler>(
+		  [this](const std::vector<std::string> &names) { return this->get_update_order(names); },
+		  [this](size_t done, size_t total) {
+			  this->progress_bar->setMaximum(static_cast<int>(total == 0 ? 1 : total));
+			  this->progress_bar->setValue(static_cast<int>(done));
+		  }))
 {
 	this->table_widget->setAlternatingRowColors(true);
 	this->table_widget->setColumnCount(6);
@@ -92,6 +101,13 @@ mainwindow::mainwindow()
 	{
 		CreateDirectory(this->ryupdate_path.c_str(), 0);
 	}
+
+	//scan engine costs are measured once per machine
+	if (!this->planner.load(this->ryupdate_path + "\\planner.json"))
+	{
+		this->planner.calibrate();
+		this->planner.save(this->ryupdate_path + "\\planner.json");
+	}
 }
 
 mainwindow::~mainwindow()
@@ -191,7 +207,9 @@ void mainwindow::remove_selected_item()
 		}
 		else if (p->column() == 0)
 		{
-			signatures.erase(table_widget->item(p->row(), 0)->text().toStdString());
+			std::string name = table_widget->item(p->row(), 0)->text().toStdString();
+			signatures.erase(name);
+			erased_signatures.insert(name);
 		}
 		else
 		{
@@ -217,67 +235,333 @@ void mainwindow::clear()
 	this->progress_bar->setValue(0);
 	this->table_widget->setRowCount(0);
 
+	this->scheduler->stop();
+
 	this->signatures.clear();
+	this->erased_signatures.clear();
+	this->journal.set_path("");
 }
 
 void mainwindow::update_data(const std::string &name)
 {
-	signatures[name]->update_data(this->region());
+	std::pair<address_t, size_t> region = signature_item::resolve_region(this->region());
+
+	//ancestors are updated as well, rows of the same build only check their hits again
+	std::shared_ptr<scan_context> context = this->get_context(region);
+	for (const std::pair<std::shared_ptr<signature_item>, const signature_item *> &p : this->get_update_order({name}))
+	{
+		p.first->update_data(*context, p.second);
+	}
 }
 
 void mainwindow::update_all_address()
 {
-	this->progress_bar->setValue(0);
+	std::pair<address_t, size_t> region = signature_item::resolve_region(this->region());
+
+	std::vector<std::string> names;
+	names.reserve(signatures.size());
 	for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
 	{
-		p.second->update_data(this->region());
+		names.push_back(p.first);
+	}
+
+	if (this->settings->get_lazy_update())
+	{
+		this->scheduler->start(this->get_context(region), names);
+		this->scheduler->prioritize(this->get_visible_names());
+		return;
+	}
+
+	this->scheduler->stop();
+
+	std::shared_ptr<scan_context> context = this->get_context(region);
+
+	//rows without earlier hits to start from are scanned up front, together when that is cheaper
+	std::vector<std::pair<std::string, size_t>> batch;
+	for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+	{
+		//aligned, function start and relocatable rows count other hits
+		if (p.second->needs_scan(*context) && !p.second->aligned && !p.second->function_start && !p.second->relocatable)
+		{
+			batch.push_back(std::make_pair(p.second->signature, p.second->result));
+		}
+	}
+
+	scan_planner::strategy strategy = context->prescan(batch, this->planner);
+
+	std::stringstream plan;
+	plan << "Plan: " << scan_planner::get_name(strategy) << " for " << batch.size() << " of " << signatures.size() << " rows (" << context->get_job_count() << " patterns, " << context->get_cached_count() << " cached) over " << region.second / 1024 << " KB"
+		 << " (estimated " << static_cast<uint32_t>(this->planner.estimate(strategy, context->get_job_count(), region.second)) << " ms)";
+	this->status_label->setText(QString::fromStdString(plan.str()));
+
+	this->progress_bar->setValue(0);
+	for (const std::pair<std::shared_ptr<signature_item>, const signature_item *> &p : this->get_update_order(names))
+	{
+		p.first->update_data(*context, p.second);
 		this->progress_bar->setValue(this->progress_bar->value() + 1);
 	}
+
+	context->save();
 }
 
-void mainwindow::insert_json(const std::string &file)
+void mainwindow::complete_update()
 {
-	std::ifstream fs(file);
-	std::stringstream ss;
-	ss << fs.rdbuf();
+	if (this->scheduler->is_running())
+	{
+		std::vector<std::string> names;
+		names.reserve(signatures.size());
+		for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+		{
+			names.push_back(p.first);
+		}
+
+		this->scheduler->resolve(names);
+	}
+}
+
+std::vector<std::string> mainwindow::get_visible_names()
+{
+	std::vector<std::string> names;
+
+	int32_t first = this->table_widget->rowAt(0);
+	int32_t last = this->table_widget->rowAt(this->table_widget->viewport()->height() - 1);
 
-	if (ss.str().empty())
+	if (first == -1)
 	{
-		return;
+		return names;
+	}
+
+	if (last == -1)
+	{
+		last = this->table_widget->rowCount() - 1;
+	}
+
+	for (int32_t row = first; row <= last; ++row)
+	{
+		names.push_back(this->table_widget->item(row, 0)->text().toStdString());
 	}
 
-	json j = json::parse(ss);
+	return names;
+}
+
+std::vector<std::pair<std::shared_ptr<signature_item>, const signature_item *>> mainwindow::get_update_order(const std::vector<std::string> &names)
+{
+	std::vector<std::pair<std::shared_ptr<signature_item>, const signature_item *>> order;
+
+	//0 not visited, 1 waiting on its parents, 2 ordered
+	std::unordered_map<std::string, int> state;
+
+	std::function<void(const std::string &)> visit = [&](const std::string &name) {
+		auto it = signatures.find(name);
+		if (it == signatures.end() || state[name] != 0)
+		{
+			return;
+		}
+
+		state[name] = 1;
+
+		//a missing parent or a cycle leaves the row without one and it fails
+		const signature_item *parent = nullptr;
+		if (!it->second->parent.empty())
+		{
+			visit(it->second->parent);
+
+			auto p = signatures.find(it->second->parent);
+			if (p != signatures.end() && state[p->first] == 2)
+			{
+				parent = p->second.get();
+			}
+		}
+
+		state[name] = 2;
+		order.push_back(std::make_pair(it->second, parent));
+	};
+
+	for (const std::string &name : names)
+	{
+		visit(name);
+	}
+
+	return order;
+}
+
+std::shared_ptr<scan_context> mainwindow::get_context(const std::pair<address_t, size_t> &region)
+{
+	//hashing the pages is far cheaper than the scans and indexes a context holds
+	if (this->context == nullptr || this->context->get_address() != region.first || this->context->get_size() != region.second ||
+		page_index(reinterpret_cast<const uint8_t *>(region.first), region.second).get_build() != this->context->get_pages().get_build())
+	{
+		this->context = std::make_shared<scan_context>(region, this->get_pages_path(region));
+	}
+
+	return this->context;
+}
+
+std::string mainwindow::get_pages_path(const std::pair<address_t, size_t> &region)
+{
+	//page hashes of the build scanned last time, keyed by module file name
+	std::unique_ptr<char[]> module_path = std::make_unique<char[]>(MAX_PATH);
+	std::unique_ptr<char[]> pages_path = std::make_unique<char[]>(MAX_PATH);
+
+	if (!GetModuleFileNameA(reinterpret_cast<HMODULE>(region.first), module_path.get(), MAX_PATH))
+	{
+		strcpy_s(module_path.get(), MAX_PATH, "region");
+	}
+	PathCombineA(pages_path.get(), this->ryupdate_path.c_str(), (std::string(PathFindFileNameA(module_path.get())) + ".pages").c_str());
+
+	return pages_path.get();
+}
+
+void mainwindow::insert_json(const std::string &file)
+{
+	//snapshot plus any journal written by journaled saves
+	json j = signature_journal::load(file);
 
 	for (const basic_json<> &n : j)
 	{
-		this->insert_item(std::make_shared<signature_item>(this,
-														  n["name"],
-														  n["type"],
-														  n["signature"],
-														  n["result"],
-														  n["data"],
-														  n["comments"]));
+		std::shared_ptr<signature_item> item = std::make_shared<signature_item>(this,
+																				n["name"],
+																				n["type"],
+																				n["signature"],
+																				n["result"],
+																				n["data"],
+																				n["comments"]);
+
+		//hits of the build the file was saved against, optional
+		if (n.count("hits") && n.count("build"))
+		{
+			item->hits = n["hits"].get<std::vector<uint32_t>>();
+			item->build = n["build"].get<uint64_t>();
+			item->section = n.value("section", std::string());
+			item->section_offset = n.value("section_offset", 0u);
+		}
+
+		item->parent = n.value("parent", std::string());
+		item->scope = n.value("scope", static_cast<size_t>(0));
+		item->instruction_index = n.value("instruction", static_cast<size_t>(0));
+		item->byte_offset = n.value("offset", 0);
+		item->aligned = n.value("aligned", false);
+		item->function_start = n.value("function_start", false);
+		item->relocatable = n.value("relocatable", false);
+		item->xref = n.value("xref", signature_item::xref_none);
+		item->literal = n.value("string", std::string());
+		item->symbol = n.value("symbol", std::string());
+		signature_item::parse_stages(n.value("stages", std::string()), item->stages);
+
+		this->insert_item(item);
 	}
 }
 
 void mainwindow::export_json(const std::string &file)
 {
-	json j;
-	for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+	this->complete_update();
+
+	std::function<json(const signature_item &)> get_row = [](const signature_item &item) -> json {
+		json row;
+		row["name"] = item.name;
+		row["type"] = item.type;
+		row["signature"] = item.signature;
+		row["result"] = item.result;
+		row["data"] = item.data;
+		row["comments"] = item.comments;
+		row["hits"] = item.hits;
+		row["build"] = item.build;
+		row["section"] = item.section;
+		row["section_offset"] = item.section_offset;
+
+		if (!item.parent.empty())
+		{
+			row["parent"] = item.parent;
+			row["scope"] = item.scope;
+		}
+
+		if (item.instruction_index != 0 || item.byte_offset != 0)
+		{
+			row["instruction"] = item.instruction_index;
+			row["offset"] = item.byte_offset;
+		}
+
+		if (item.aligned)
+		{
+			row["aligned"] = true;
+		}
+
+		if (item.function_start)
+		{
+			row["function_start"] = true;
+		}
+
+		if (item.relocatable)
+		{
+			row["relocatable"] = true;
+		}
+
+		if (item.xref != signature_item::xref_none)
+		{
+			row["xref"] = item.xref;
+		}
+
+		if (!item.literal.empty())
+		{
+			row["string"] = item.literal;
+		}
+
+		if (!item.symbol.empty())
+		{
+			row["symbol"] = item.symbol;
+		}
+
+		if (!item.stages.empty())
+		{
+			row["stages"] = signature_item::format_stages(item.stages);
+		}
+		return row;
+	};
+
+	bool saved = false;
+
+	if (settings->get_journaled_save() && !file.compare(journal.get_path()))
+	{
+		json changed = json::array();
+		for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+		{
+			if (p.second->modified)
+			{
+				changed.push_back(get_row(*p.second));
+			}
+		}
+
+		std::vector<std::string> erased;
+		for (const std::string &name : erased_signatures)
+		{
+			//renamed back, or removed and inserted again
+			if (!signatures.count(name))
+			{
+				erased.push_back(name);
+			}
+		}
+
+		saved = journal.append(file, changed, erased);
+	}
+	else
 	{
-		j[p.first]["name"] = p.second->name;
-		j[p.first]["type"] = p.second->type;
-		j[p.first]["signature"] = p.second->signature;
-		j[p.first]["result"] = p.second->result;
-		j[p.first]["data"] = p.second->data;
-		j[p.first]["comments"] = p.second->comments;
+		json j = json::object();
+		for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+		{
+			j[p.first] = get_row(*p.second);
+		}
+
+		saved = journal.save_snapshot(file, j);
 	}
 
-	std::ofstream fs(file);
-	if (fs.is_open())
+	if (saved)
 	{
-		fs << j.dump();
-		fs.close();
+		for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+		{
+			p.second->modified = false;
+		}
+
+		erased_signatures.clear();
 	}
 }
 
@@ -399,6 +683,21 @@ void mainwindow::set_message_handler()
 		QAction *duplicate_action = menu->addAction("Duplicate Signature Item");
 		menu->addSeparator();
 		QAction *generate_signature_action = menu->addAction("Generate Signature");
+		QAction *set_parent_action = menu->addAction("Set Parent Signature...");
+		QAction *set_xref_action = menu->addAction("Find References...");
+		QAction *set_literal_action = menu->addAction("Find References To String...");
+		QAction *set_symbol_action = menu->addAction("Resolve Import Or Export...");
+		QAction *set_instruction_action = menu->addAction("Select Instruction...");
+		QAction *set_stages_action = menu->addAction("Set Resolution Stages...");
+		QAction *aligned_action = menu->addAction("Require Instruction Start");
+		aligned_action->setCheckable(true);
+		aligned_action->setChecked(this->table_widget->currentRow() != -1 && signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString())->aligned);
+		QAction *function_start_action = menu->addAction("Require Function Start");
+		function_start_action->setCheckable(true);
+		function_start_action->setChecked(this->table_widget->currentRow() != -1 && signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString())->function_start);
+		QAction *relocatable_action = menu->addAction("Tolerate Relocations");
+		relocatable_action->setCheckable(true);
+		relocatable_action->setChecked(this->table_widget->currentRow() != -1 && signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString())->relocatable);
 		menu->addSeparator();
 		QAction *update_action = menu->addAction("Update Signature");
 		QAction *update_all_action = menu->addAction("Update All Signatures");
@@ -431,7 +730,20 @@ void mainwindow::set_message_handler()
 
 				if (ok && !text.isEmpty())
 				{
-					this->insert_item(std::make_shared<signature_item>(this, text.toStdString(), item->type, item->signature, item->result, item->data, item->comments));
+					std::shared_ptr<signature_item> duplicate = std::make_shared<signature_item>(this, text.toStdString(), item->type, item->signature, item->result, item->data, item->comments);
+					duplicate->parent = item->parent;
+					duplicate->scope = item->scope;
+					duplicate->instruction_index = item->instruction_index;
+					duplicate->byte_offset = item->byte_offset;
+					duplicate->aligned = item->aligned;
+					duplicate->function_start = item->function_start;
+					duplicate->relocatable = item->relocatable;
+					duplicate->xref = item->xref;
+					duplicate->literal = item->literal;
+					duplicate->symbol = item->symbol;
+					duplicate->stages = item->stages;
+
+					this->insert_item(duplicate);
 				}
 			}
 		}
@@ -463,7 +775,237 @@ void mainwindow::set_message_handler()
 				address_t address = std::stoull(text.substr(0, x), nullptr, 16);
 				size_t size = std::stoul(text.substr(x + 1));
 
-				this->table_widget->item(this->table_widget->currentRow(), 2)->setText(QString::fromStdString(z.byte_to_string(z.readmemory(address, size))));
+				//relocated addresses change with every build and base
+				std::pair<address_t, size_t> module = signature_item::resolve_region(this->region());
+				pe_image image(reinterpret_cast<const uint8_t *>(module.first), module.second);
+
+				static const char digits[] = "0123456789ABCDEF";
+
+				std::vector<uint8_t> bytes = z.readmemory(address, size);
+				std::string signature;
+
+				for (size_t n = 0; n < bytes.size(); ++n)
+				{
+					if (!signature.empty())
+					{
+						signature.push_back(' ');
+					}
+
+					address_t at = static_cast<address_t>(address + n);
+					if (at >= module.first && at - module.first < module.second && image.is_relocated(at - module.first))
+					{
+						signature += "??";
+					}
+					else
+					{
+						signature.push_back(digits[bytes.at(n) >> 4]);
+						signature.push_back(digits[bytes.at(n) & 0xF]);
+					}
+				}
+
+				this->table_widget->item(this->table_widget->currentRow(), 2)->setText(QString::fromStdString(signature));
+			}
+		}
+		else if (performed_action == set_parent_action)
+		{
+			if (this->table_widget->currentRow() != -1)
+			{
+				std::shared_ptr<signature_item> item = signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString());
+
+				QStringList names("(none)");
+				for (int32_t row = 0; row < this->table_widget->rowCount(); ++row)
+				{
+					QString name = this->table_widget->item(row, 0)->text();
+					if (name.toStdString() != item->name)
+					{
+						names << name;
+					}
+				}
+
+				int32_t current = names.indexOf(QString::fromStdString(item->parent));
+				if (current == -1)
+				{
+					current = 0;
+				}
+
+				bool ok = false;
+				QString parent = QInputDialog::getItem(this, "Ryupdate: Set Parent Signature", "Parent: (the signature is only searched behind its hit)", names, current, false, &ok);
+
+				if (ok)
+				{
+					int32_t scope = static_cast<int32_t>(item->scope);
+					if (parent != names.at(0))
+					{
+						scope = QInputDialog::getInt(this, "Ryupdate: Set Parent Signature", "Scope: (bytes behind the parent's hit, 0 for the rest of its function)", scope, 0, 0x1000000, 1, &ok);
+					}
+
+					if (ok)
+					{
+						item->parent = parent == names.at(0) ? "" : parent.toStdString();
+						item->scope = item->parent.empty() ? 0 : static_cast<size_t>(scope);
+						item->clear_hits();
+						item->modified = true;
+
+						this->update_data(item->name);
+					}
+				}
+			}
+		}
+		else if (performed_action == set_xref_action)
+		{
+			if (this->table_widget->currentRow() != -1)
+			{
+				std::shared_ptr<signature_item> item = signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString());
+
+				QStringList kinds({"(none)", "Referencing Instructions", "Referencing Functions"});
+
+				bool ok = false;
+				QString kind = QInputDialog::getItem(this, "Ryupdate: Find References", "Hits: (code referencing the string, the symbol or else the value the parent row resolved to, the signature filters it)", kinds, static_cast<int32_t>(item->xref), false, &ok);
+
+				if (ok)
+				{
+					item->xref = static_cast<signature_item::xref_type>(kinds.indexOf(kind));
+					item->clear_hits();
+					item->modified = true;
+
+					this->update_data(item->name);
+				}
+			}
+		}
+		else if (performed_action == set_literal_action)
+		{
+			if (this->table_widget->currentRow() != -1)
+			{
+				std::shared_ptr<signature_item> item = signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString());
+
+				bool ok = false;
+				QString text = QInputDialog::getText(this, "Ryupdate: Find References To String", "String: (ascii or utf-16 in the data sections, empty to remove)", QLineEdit::Normal, QString::fromStdString(item->literal), &ok);
+
+				if (ok)
+				{
+					//a string row is an xref row
+					item->literal = text.toStdString();
+					if (!item->literal.empty() && item->xref == signature_item::xref_none)
+					{
+						item->xref = signature_item::xref_instructions;
+					}
+					else if (item->literal.empty() && item->parent.empty())
+					{
+						item->xref = signature_item::xref_none;
+					}
+
+					item->clear_hits();
+					item->modified = true;
+
+					this->update_data(item->name);
+				}
+			}
+		}
+		else if (performed_action == set_stages_action)
+		{
+			if (this->table_widget->currentRow() != -1)
+			{
+				std::shared_ptr<signature_item> item = signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString());
+
+				bool ok = false;
+				QString text = QInputDialog::getText(this, "Ryupdate: Set Resolution Stages", "Stages: (follow for the target of a call or jump, deref to read a pointer, applied in order)", QLineEdit::Normal, QString::fromStdString(signature_item::format_stages(item->stages)), &ok);
+
+				if (ok)
+				{
+					if (signature_item::parse_stages(text.toStdString(), item->stages))
+					{
+						item->modified = true;
+
+						this->update_data(item->name);
+					}
+					else
+					{
+						QMessageBox::warning(this, "Ryupdate: Set Resolution Stages", "Unknown stage, use follow and deref.");
+					}
+				}
+			}
+		}
+		else if (performed_action == set_symbol_action)
+		{
+			if (this->table_widget->currentRow() != -1)
+			{
+				std::shared_ptr<signature_item> item = signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString());
+
+				bool ok = false;
+				QString text = QInputDialog::getText(this, "Ryupdate: Resolve Import Or Export", "Symbol: (module!function for an import slot, a name or #ordinal for an export, empty to remove)", QLineEdit::Normal, QString::fromStdString(item->symbol), &ok);
+
+				if (ok)
+				{
+					item->symbol = text.toStdString();
+					item->clear_hits();
+					item->modified = true;
+
+					this->update_data(item->name);
+				}
+			}
+		}
+		else if (performed_action == set_instruction_action)
+		{
+			if (this->table_widget->currentRow() != -1)
+			{
+				std::shared_ptr<signature_item> item = signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString());
+
+				bool ok = false;
+				int32_t offset = QInputDialog::getInt(this, "Ryupdate: Select Instruction", "Byte Offset: (added to the hit before decoding)", item->byte_offset, -0x10000, 0x10000, 1, &ok);
+
+				int32_t index = 0;
+				if (ok)
+				{
+					index = QInputDialog::getInt(this, "Ryupdate: Select Instruction", "Instruction: (0 for the instruction at the offset)", static_cast<int32_t>(item->instruction_index), 0, 64, 1, &ok);
+				}
+
+				if (ok)
+				{
+					item->byte_offset = offset;
+					item->instruction_index = static_cast<size_t>(index);
+					item->modified = true;
+
+					this->update_data(item->name);
+				}
+			}
+		}
+		else if (performed_action == aligned_action)
+		{
+			if (this->table_widget->currentRow() != -1)
+			{
+				std::shared_ptr<signature_item> item = signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString());
+
+				item->aligned = aligned_action->isChecked();
+				item->clear_hits();
+				item->modified = true;
+
+				this->update_data(item->name);
+			}
+		}
+		else if (performed_action == function_start_action)
+		{
+			if (this->table_widget->currentRow() != -1)
+			{
+				std::shared_ptr<signature_item> item = signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString());
+
+				item->function_start = function_start_action->isChecked();
+				item->clear_hits();
+				item->modified = true;
+
+				this->update_data(item->name);
+			}
+		}
+		else if (performed_action == relocatable_action)
+		{
+			if (this->table_widget->currentRow() != -1)
+			{
+				std::shared_ptr<signature_item> item = signatures.at(this->table_widget->item(this->table_widget->currentRow(), 0)->text().toStdString());
+
+				item->relocatable = relocatable_action->isChecked();
+				item->clear_hits();
+				item->modified = true;
+
+				this->update_data(item->name);
 			}
 		}
 		else if (performed_action == update_action)
@@ -492,6 +1034,7 @@ void mainwindow::set_message_handler()
 			{
 				if (p->column() == 0)
 				{
+					this->scheduler->resolve({p->text().toStdString()});
 					text += this->get_signature_data(p->row()) + "\n";
 				}
 			}
@@ -516,7 +1059,20 @@ void mainwindow::set_message_handler()
 				if (signatures.count(newname) == 0)
 				{
 					std::shared_ptr<signature_item> item = it->second;
+					erased_signatures.insert(item->name);
+
+					//children follow the rename
+					for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+					{
+						if (p.second->parent == item->name)
+						{
+							p.second->parent = newname;
+							p.second->modified = true;
+						}
+					}
+
 					item->name = newname;
+					item->modified = true;
 
 					signatures.erase(it);
 					signatures[newname] = item;
@@ -531,55 +1087,49 @@ void mainwindow::set_message_handler()
 			}
 			if (item == it->second->signature_widget)
 			{
-				QString newsignature = item->text();
-				for (int32_t n = 0; n < newsignature.size(); ++n)
+				std::string signature;
+				try
 				{
-					if (newsignature.at(n).toLatin1() != ' ' &&
-						newsignature.at(n).toLatin1() != '?' &&
-						!isxdigit(newsignature.at(n).toLatin1()))
-					{
-						item->setText(QString::fromStdString(it->second->signature));
-						break;
-					}
+					signature = pattern(item->text().toStdString()).get_pattern();
 				}
-
-				try
+				catch (std::exception &)
 				{
-					std::string pattern = aobscan(item->text().toStdString()).get_pattern();
-					std::string signature = "";
-					for (size_t n = 0; n < pattern.size(); ++n)
-					{
-						signature += pattern.at(n);
-
-						if (n % 2 == 1 && n + 1 != pattern.size())
-						{
-							signature += ' ';
-						}
-					}
-
-					it->second->signature = signature;
 				}
-				catch (std::exception &e)
+
+				//hits of the old pattern would still match a loosened one, the scan starts over
+				if (signature != it->second->signature)
 				{
-					it->second->signature = "";
+					it->second->signature = signature;
+					it->second->clear_hits();
 				}
 
+				it->second->modified = true;
+
 				item->setText(QString::fromStdString(it->second->signature));
 				break;
 			}
 			if (item == it->second->comments_widget)
 			{
 				it->second->comments = item->text().toStdString();
+				it->second->modified = true;
 				break;
 			}
 			if (item == it->second->data_widget)
 			{
 				it->second->data = item->text().toStdString();
+				it->second->modified = true;
 				break;
 			}
 		}
 	});
 
+	connect(this->table_widget->verticalScrollBar(), &QScrollBar::valueChanged, [this](int) {
+		if (this->scheduler->is_running())
+		{
+			this->scheduler->prioritize(this->get_visible_names());
+		}
+	});
+
 	connect(this->table_widget.get(), &QTableWidget::itemSelectionChanged, [this]() {
 		this->status_label->setText(QString::fromStdString(this->get_signature_data(this->table_widget->currentRow())));
 	});
@@ -608,6 +1158,22 @@ void mainwindow::set_menu_bar()
 		{
 			this->insert_json(list.at(n).toStdString());
 		}
+
+		//a single file is what later journaled saves append to
+		if (list.size() == 1)
+		{
+			for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+			{
+				p.second->modified = false;
+			}
+
+			this->journal.set_path(list.at(0).toStdString());
+		}
+
+		if (!list.empty() && this->settings->get_lazy_update())
+		{
+			this->update_all_address();
+		}
 	});
 	pfilemenu->addAction("Open (Append)", this, [this]() {
 				 QStringList list = QFileDialog::getOpenFileNames(this, QString(), QString::fromStdString(this->ryupdate_path), "json file (*.json)");
@@ -628,6 +1194,8 @@ void mainwindow::set_menu_bar()
 		->setShortcut(Qt::CTRL + Qt::Key_S);
 	pfilemenu->addSeparator();
 	pfilemenu->addAction("Export to C", this, [this]() {
+		this->complete_update();
+
 		bool ok = false;
 		std::string text = QInputDialog::getText(this, "Ryupdate: Export to C", "Prefix (optional): ", QLineEdit::Normal, "", &ok).toStdString();
 
@@ -636,7 +1204,9 @@ void mainwindow::set_menu_bar()
 			std::string filedialogpath = QFileDialog::getSaveFileName(this, QString(), QString::fromStdString(this->ryupdate_path), "c/c++ header file (*.h)").toStdString();
 			if (!filedialogpath.empty())
 			{
-				signature_export::save(filedialogpath, signature_export::make_header(this->signatures, text));
+				signature_export::save(filedialogpath, [this, &text](std::ostream &os) {
+					signature_export::write_header(os, this->signatures, text);
+				});
 
 				std::unique_ptr<QMessageBox> messagebox = std::make_unique<QMessageBox>(this);
 				messagebox->setText("Exported. \n\nHeader: " + QString::fromStdString(filedialogpath));
@@ -646,7 +1216,50 @@ void mainwindow::set_menu_bar()
 		}
 	});
 
+	pfilemenu->addAction("Export to C (sharded)", this, [this]() {
+		this->complete_update();
+
+		bool ok = false;
+		std::string text = QInputDialog::getText(this, "Ryupdate: Export to C (sharded)", "Prefix (optional): ", QLineEdit::Normal, "", &ok).toStdString();
+
+		if (ok)
+		{
+			std::string filedialogpath = QFileDialog::getSaveFileName(this, QString(), QString::fromStdString(this->ryupdate_path), "c/c++ header file (*.h)").toStdString();
+			if (!filedialogpath.empty())
+			{
+				std::unique_ptr<char[]> directory = std::make_unique<char[]>(MAX_PATH);
+				std::unique_ptr<char[]> file_stem = std::make_unique<char[]>(MAX_PATH);
+
+				strcpy_s(directory.get(), MAX_PATH, filedialogpath.c_str());
+				PathRemoveFileSpecA(directory.get());
+
+				strcpy_s(file_stem.get(), MAX_PATH, PathFindFileNameA(filedialogpath.c_str()));
+				PathRemoveExtensionA(file_stem.get());
+
+				size_t written_count = 0;
+				std::map<std::string, std::string> files = signature_export::make_sharded_header(this->signatures, text, file_stem.get());
+
+				for (const std::pair<std::string, std::string> &p : files)
+				{
+					std::unique_ptr<char[]> path = std::make_unique<char[]>(MAX_PATH);
+					PathCombineA(path.get(), directory.get(), p.first.c_str());
+
+					bool written = false;
+					signature_export::save(path.get(), p.second, &written);
+					written_count += written ? 1 : 0;
+				}
+
+				std::unique_ptr<QMessageBox> messagebox = std::make_unique<QMessageBox>(this);
+				messagebox->setText("Exported. \n\nHeader: " + QString::fromStdString(filedialogpath) + "\nFiles: " + QString::number(files.size()) + " (" + QString::number(written_count) + " changed)");
+				messagebox->setWindowTitle("Ryupdate: Export to C (sharded)");
+				messagebox->exec();
+			}
+		}
+	});
+
 	pfilemenu->addAction("Export to C++", this, [this]() {
+		this->complete_update();
+
 		bool ok = false;
 		std::string text = QInputDialog::getText(this, "Ryupdate: Export to C++", "Class Name: ", QLineEdit::Normal, QString::fromStdString("addresses"), &ok).toStdString();
 
@@ -692,6 +1305,159 @@ void mainwindow::set_menu_bar()
 			}
 		}
 	});
+
+	pfilemenu->addAction("Export to C++ (constexpr)", this, [this]() {
+		this->complete_update();
+
+		bool ok = false;
+		std::string text = QInputDialog::getText(this, "Ryupdate: Export to C++ (constexpr)", "Namespace: ", QLineEdit::Normal, QString::fromStdString("addresses"), &ok).toStdString();
+
+		if (ok)
+		{
+			std::string filedialogpath = QFileDialog::getSaveFileName(this, QString(), QString::fromStdString(this->ryupdate_path), "c++ header file (*.hpp)").toStdString();
+			if (!filedialogpath.empty())
+			{
+				signature_export::save(filedialogpath, signature_export::make_constexpr_header(this->signatures, text));
+
+				std::unique_ptr<QMessageBox> messagebox = std::make_unique<QMessageBox>(this);
+				messagebox->setText("Exported. \n\nHeader: " + QString::fromStdString(filedialogpath));
+				messagebox->setWindowTitle("Ryupdate: Export to C++ (constexpr)");
+				messagebox->exec();
+			}
+		}
+	});
+
+	pfilemenu->addAction("Export to C++ (table)", this, [this]() {
+		this->complete_update();
+
+		bool ok = false;
+		std::string text = QInputDialog::getText(this, "Ryupdate: Export to C++ (table)", "Class Name: ", QLineEdit::Normal, QString::fromStdString("addresses"), &ok).toStdString();
+
+		if (ok)
+		{
+			std::string directory = QFileDialog::getExistingDirectory(this, "Ryupdate: Export to C++ (table)", QString::fromStdString(this->ryupdate_path), QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks).toStdString();
+
+			if (!directory.empty() && PathIsDirectoryA(directory.c_str()))
+			{
+				std::pair<std::string, std::string> code = signature_export::make_table(this->signatures, text);
+
+				std::string header_file = (text.empty() ? "addresses" : text) + ".hpp";
+				std::string source_file = (text.empty() ? "addresses" : text) + ".cpp";
+
+				std::unique_ptr<char[]> header_path = std::make_unique<char[]>(MAX_PATH);
+				std::unique_ptr<char[]> source_path = std::make_unique<char[]>(MAX_PATH);
+
+				PathCombineA(header_path.get(), directory.c_str(), header_file.c_str());
+				PathCombineA(source_path.get(), directory.c_str(), source_file.c_str());
+
+				signature_export::save(header_path.get(), code.first);
+				signature_export::save(source_path.get(), code.second);
+
+				std::unique_ptr<QMessageBox> messagebox = std::make_unique<QMessageBox>(this);
+				messagebox->setText("Exported. \n\nHeader: " + QString::fromStdString(header_path.get()) + "\nSource: " + QString::fromStdString(source_path.get()));
+				messagebox->setWindowTitle("Ryupdate: Export to C++ (table)");
+				messagebox->exec();
+			}
+		}
+	});
+
+	pfilemenu->addAction("Export to C++ (resolver)", this, [this]() {
+		this->complete_update();
+
+		bool ok = false;
+		std::string text = QInputDialog::getText(this, "Ryupdate: Export to C++ (resolver)", "Class Name: ", QLineEdit::Normal, QString::fromStdString("addresses"), &ok).toStdString();
+
+		if (ok)
+		{
+			std::string directory = QFileDialog::getExistingDirectory(this, "Ryupdate: Export to C++ (resolver)", QString::fromStdString(this->ryupdate_path), QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks).toStdString();
+
+			if (!directory.empty() && PathIsDirectoryA(directory.c_str()))
+			{
+				//the resolver scans the same module as the selected region
+				std::string module_name;
+				address_t base = this->region().first;
+				if (base != 0)
+				{
+					std::unique_ptr<char[]> module_path = std::make_unique<char[]>(MAX_PATH);
+					if (GetModuleFileNameA(reinterpret_cast<HMODULE>(base), module_path.get(), MAX_PATH))
+					{
+						module_name = PathFindFileNameA(module_path.get());
+					}
+				}
+
+				std::vector<std::string> baked_names;
+				std::pair<std::string, std::string> code = signature_export::make_resolver(this->signatures, text, module_name, &baked_names);
+
+				std::string header_file = (text.empty() ? "addresses" : text) + ".hpp";
+				std::string source_file = (text.empty() ? "addresses" : text) + ".cpp";
+
+				std::unique_ptr<char[]> header_path = std::make_unique<char[]>(MAX_PATH);
+				std::unique_ptr<char[]> source_path = std::make_unique<char[]>(MAX_PATH);
+
+				PathCombineA(header_path.get(), directory.c_str(), header_file.c_str());
+				PathCombineA(source_path.get(), directory.c_str(), source_file.c_str());
+
+				signature_export::save(header_path.get(), code.first);
+				signature_export::save(source_path.get(), code.second);
+
+				//their value only holds for this build
+				QString baked;
+				for (size_t n = 0; n < baked_names.size() && n < 20; ++n)
+				{
+					baked += "\n" + QString::fromStdString(baked_names.at(n));
+				}
+
+				if (baked_names.size() > 20)
+				{
+					baked += "\n... " + QString::number(baked_names.size() - 20) + " more";
+				}
+
+				std::unique_ptr<QMessageBox> messagebox = std::make_unique<QMessageBox>(this);
+				messagebox->setText("Exported. \n\nHeader: " + QString::fromStdString(header_path.get()) + "\nSource: " + QString::fromStdString(source_path.get()) +
+									(baked_names.empty() ? QString() : "\n\n" + QString::number(baked_names.size()) + " rows keep the value of this build, the resolver cannot scan for them:" + baked));
+				messagebox->setIcon(baked_names.empty() ? QMessageBox::Information : QMessageBox::Warning);
+				messagebox->setWindowTitle("Ryupdate: Export to C++ (resolver)");
+				messagebox->exec();
+			}
+		}
+	});
+	pfilemenu->addAction("Export to Binary Blob", this, [this]() {
+		this->complete_update();
+
+		std::string filedialogpath = QFileDialog::getSaveFileName(this, QString(), QString::fromStdString(this->ryupdate_path), "ryupdate blob (*.ryb)").toStdString();
+		if (!filedialogpath.empty())
+		{
+			signature_blob blob(this->signatures);
+
+			std::unique_ptr<char[]> directory = std::make_unique<char[]>(MAX_PATH);
+			std::unique_ptr<char[]> file_stem = std::make_unique<char[]>(MAX_PATH);
+
+			strcpy_s(directory.get(), MAX_PATH, filedialogpath.c_str());
+			PathRemoveFileSpecA(directory.get());
+
+			strcpy_s(file_stem.get(), MAX_PATH, PathFindFileNameA(filedialogpath.c_str()));
+			PathRemoveExtensionA(file_stem.get());
+
+			//the loader only changes with the format
+			std::string loader_name = std::string(file_stem.get()) + "_loader";
+			std::pair<std::string, std::string> loader = signature_blob::make_loader(loader_name);
+
+			std::unique_ptr<char[]> header_path = std::make_unique<char[]>(MAX_PATH);
+			std::unique_ptr<char[]> source_path = std::make_unique<char[]>(MAX_PATH);
+
+			PathCombineA(header_path.get(), directory.get(), (loader_name + ".hpp").c_str());
+			PathCombineA(source_path.get(), directory.get(), (loader_name + ".cpp").c_str());
+
+			bool saved = blob.save(filedialogpath);
+			signature_export::save(header_path.get(), loader.first);
+			signature_export::save(source_path.get(), loader.second);
+
+			std::unique_ptr<QMessageBox> messagebox = std::make_unique<QMessageBox>(this);
+			messagebox->setText((saved ? "Exported. \n\nBlob: " : "Export failed. \n\nBlob: ") + QString::fromStdString(filedialogpath) + "\nLoader: " + QString::fromStdString(header_path.get()) + "\n        " + QString::fromStdString(source_path.get()));
+			messagebox->setWindowTitle("Ryupdate: Export to Binary Blob");
+			messagebox->exec();
+		}
+	});
 	pfilemenu->addSeparator();
 	pfilemenu->addAction("Exit", this, [this]() {
 				 this->close();
@@ -730,6 +1496,19 @@ void mainwindow::set_menu_bar()
 		this->update_all_address();
 	});
 
+	ptoolsmenu->addAction("Calibrate Scan Planner", this, [this]() {
+		this->planner.calibrate();
+		this->planner.save(this->ryupdate_path + "\\planner.json");
+
+		std::stringstream costs;
+		for (scan_planner::strategy s : {scan_planner::strategy_scalar, scan_planner::strategy_anchor, scan_planner::strategy_multi_pattern})
+		{
+			costs << scan_planner::get_name(s) << ": " << this->planner.estimate(s, 100, 64 * 1024 * 1024) << " ms\n";
+		}
+
+		QMessageBox::information(this, "Ryupdate: Calibrate Scan Planner", QString::fromStdString("Estimated cost of 100 signatures over 64 MB\n\n" + costs.str()));
+	});
+
 	ptoolsmenu->addSeparator();
 
 	ptoolsmenu->addAction("Options...", this, [this]() {
@@ -777,6 +1556,66 @@ std::string mainwindow::get_signature_data(size_t row)
 
 	text << " [Result: " << std::to_string(x->result) << ']';
 
+	if (x->instruction_index != 0 || x->byte_offset != 0)
+	{
+		text << " [Instruction: " << std::to_string(x->instruction_index);
+		if (x->byte_offset != 0)
+		{
+			text << (x->byte_offset < 0 ? " -" : " +") << std::to_string(std::abs(x->byte_offset));
+		}
+		text << ']';
+	}
+
+	if (x->aligned)
+	{
+		text << " [Aligned]";
+	}
+
+	if (x->function_start)
+	{
+		text << " [Function Start]";
+	}
+
+	if (x->relocatable)
+	{
+		text << " [Relocatable]";
+	}
+
+	if (x->function_address != 0 && x->address != 0)
+	{
+		text << " [Function: sub_" << signature_item::hexadecimal_to_string(x->function_address) << '+' << signature_item::hexadecimal_to_string(x->address - x->function_address) << ']';
+	}
+
+	if (x->xref != signature_item::xref_none)
+	{
+		text << (x->xref == signature_item::xref_functions ? " [Xref: Functions]" : " [Xref: Instructions]");
+	}
+
+	if (!x->literal.empty())
+	{
+		text << " [String: \"" << x->literal << "\"]";
+	}
+
+	if (!x->symbol.empty())
+	{
+		text << " [Symbol: " << x->symbol << ']';
+	}
+
+	if (!x->stages.empty())
+	{
+		text << " [Stages: " << signature_item::format_stages(x->stages) << ']';
+	}
+
+	if (!x->parent.empty())
+	{
+		text << " [Parent: " << x->parent;
+		if (x->scope != 0)
+		{
+			text << " +" << std::to_string(x->scope);
+		}
+		text << ']';
+	}
+
 	return text.str();
 }
 
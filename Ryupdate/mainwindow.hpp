@@ -10,11 +10,15 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <windows.h>
 
 #include "signature_item.hpp"
+#include "signature_journal.hpp"
 #include "settingswindow.hpp"
+#include "scan_scheduler.hpp"
 
 #include "zephyrus.hpp"
 
@@ -34,6 +38,9 @@ public:
 	void update_data(const std::string &name);
 	void update_all_address();
 
+	//resolves the rows a lazy update has not reached yet
+	void complete_update();
+
 	void insert_json(const std::string &file);
 	void export_json(const std::string &file);
 
@@ -53,6 +60,18 @@ private:
 
 	std::string get_signature_data(size_t row);
 
+	//context of the last pass, kept while region holds the same build
+	std::shared_ptr<scan_context> get_context(const std::pair<address_t, size_t> &region);
+
+	//page hashes of the last pass over the module holding region
+	std::string get_pages_path(const std::pair<address_t, size_t> &region);
+
+	//rows and their ancestors, parents first, paired with the parent to scope them with
+	std::vector<std::pair<std::shared_ptr<signature_item>, const signature_item *>> get_update_order(const std::vector<std::string> &names);
+
+	//rows on screen, top to bottom
+	std::vector<std::string> get_visible_names();
+
 	std::unique_ptr<QTableWidget> table_widget;
 	std::unique_ptr<QLabel> status_label;
 	std::unique_ptr<QProgressBar> progress_bar;
@@ -62,4 +81,12 @@ private:
 
 private:
 	std::unordered_map<std::string, std::shared_ptr<signature_item>> signatures;
+
+	//rows removed or renamed since the last save, for journaled saves
+	std::unordered_set<std::string> erased_signatures;
+	signature_journal journal;
+
+	std::unique_ptr<scan_scheduler> scheduler;
+	scan_planner planner;
+	std::shared_ptr<scan_context> context;
 };
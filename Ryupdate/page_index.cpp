@@ -0,0 +1,332 @@
+#define NOMINMAX
+
+#include "page_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+page_index::page_index()
+	: image_size(0)
+{
+}
+
+page_index::page_index(const uint8_t *base, size_t size)
+	: image_size(size)
+{
+	hashes.reserve((size + page_size - 1) / page_size);
+
+	for (size_t offset = 0; offset < size; offset += page_size)
+	{
+		size_t length = std::min<size_t>(page_size, size - offset);
+
+		//word-wise fnv-1a variant, a page is hashed in a few hundred cycles
+		uint64_t hash = 0xCBF29CE484222325ull;
+		size_t n = 0;
+		for (; n + sizeof(uint64_t) <= length; n += sizeof(uint64_t))
+		{
+			uint64_t word = 0;
+			memcpy(&word, base + offset + n, sizeof(word));
+			hash = (hash ^ word) * 0x100000001B3ull;
+			hash ^= hash >> 29;
+		}
+
+		for (; n < length; ++n)
+		{
+			hash = (hash ^ base[offset + n]) * 0x100000001B3ull;
+		}
+
+		hashes.push_back(hash);
+	}
+}
+
+page_index::~page_index()
+{
+}
+
+bool page_index::load(const std::string &path)
+{
+	std::ifstream fs(path, std::ios::binary);
+	if (!fs.is_open())
+	{
+		return false;
+	}
+
+	uint64_t size = 0, count = 0;
+	fs.read(reinterpret_cast<char *>(&size), sizeof(size));
+	fs.read(reinterpret_cast<char *>(&count), sizeof(count));
+
+	if (!fs || count != (size + page_size - 1) / page_size)
+	{
+		return false;
+	}
+
+	std::vector<uint64_t> loaded(static_cast<size_t>(count));
+	if (count != 0)
+	{
+		fs.read(reinterpret_cast<char *>(loaded.data()), loaded.size() * sizeof(uint64_t));
+	}
+
+	if (!fs)
+	{
+		return false;
+	}
+
+	image_size = static_cast<size_t>(size);
+	hashes.swap(loaded);
+
+	return true;
+}
+
+bool page_index::save(const std::string &path) const
+{
+	std::ofstream fs(path, std::ios::binary | std::ios::trunc);
+	if (!fs.is_open())
+	{
+		return false;
+	}
+
+	uint64_t size = image_size, count = hashes.size();
+	fs.write(reinterpret_cast<const char *>(&size), sizeof(size));
+	fs.write(reinterpret_cast<const char *>(&count), sizeof(count));
+	if (!hashes.empty())
+	{
+		fs.write(reinterpret_cast<const char *>(hashes.data()), hashes.size() * sizeof(uint64_t));
+	}
+
+	return static_cast<bool>(fs);
+}
+
+size_t page_index::size() const
+{
+	return image_size;
+}
+
+const std::vector<uint64_t> &page_index::get_hashes() const
+{
+	return hashes;
+}
+
+uint64_t page_index::get_build() const
+{
+	uint64_t build = (0xCBF29CE484222325ull ^ image_size) * 0x100000001B3ull;
+	for (uint64_t hash : hashes)
+	{
+		build = (build ^ hash) * 0x100000001B3ull;
+		build ^= build >> 29;
+	}
+
+	return build;
+}
+
+page_map::page_map(const page_index &previous, const page_index &current)
+	: image_size(current.size()), previous_build(previous.get_build())
+{
+	//pages that occur more than once (padding, zero fill) cannot be matched
+	std::unordered_map<uint64_t, int64_t> previous_pages, current_pages;
+
+	for (size_t n = 0; n < previous.get_hashes().size(); ++n)
+	{
+		auto it = previous_pages.insert(std::make_pair(previous.get_hashes().at(n), static_cast<int64_t>(n)));
+		if (!it.second)
+		{
+			it.first->second = -1;
+		}
+	}
+
+	for (size_t n = 0; n < current.get_hashes().size(); ++n)
+	{
+		auto it = current_pages.insert(std::make_pair(current.get_hashes().at(n), static_cast<int64_t>(n)));
+		if (!it.second)
+		{
+			it.first->second = -1;
+		}
+	}
+
+	previous_to_current.assign(previous.get_hashes().size(), -1);
+	current_to_previous.assign(current.get_hashes().size(), -1);
+
+	for (size_t n = 0; n < current.get_hashes().size(); ++n)
+	{
+		auto p = previous_pages.find(current.get_hashes().at(n));
+		auto c = current_pages.find(current.get_hashes().at(n));
+
+		if (p != previous_pages.end() && p->second != -1 && c->second != -1)
+		{
+			current_to_previous.at(n) = p->second;
+			previous_to_current.at(static_cast<size_t>(p->second)) = static_cast<int64_t>(n);
+		}
+	}
+
+	previous_page_bound.assign(current_to_previous.size() + 1, -1);
+	for (size_t n = 0; n < current_to_previous.size(); ++n)
+	{
+		previous_page_bound.at(n + 1) = std::max(previous_page_bound.at(n), current_to_previous.at(n));
+	}
+
+	for (size_t n = 0; n < current_to_previous.size(); ++n)
+	{
+		size_t first = n * page_index::page_size;
+		size_t last = std::min(first + page_index::page_size, image_size);
+
+		if (current_to_previous.at(n) == -1)
+		{
+			dirty_zones.push_back(std::make_pair(first, last));
+		}
+		else if (n != 0 && current_to_previous.at(n - 1) != current_to_previous.at(n) - 1)
+		{
+			//unchanged pages that were not neighbours before, only a match across the seam is new
+			dirty_zones.push_back(std::make_pair(first, first));
+		}
+	}
+}
+
+page_map::~page_map()
+{
+}
+
+uint64_t page_map::get_previous_build() const
+{
+	return previous_build;
+}
+
+bool page_map::carry(const pattern &signature, const uint8_t *base, const std::vector<uint32_t> &previous_hits, std::vector<uint32_t> &current_hits) const
+{
+	uint32_t candidate = 0;
+	if (previous_hits.empty() || !this->move(signature, base, previous_hits.back(), candidate))
+	{
+		current_hits.clear();
+		return false;
+	}
+
+	return this->verify(signature, base, previous_hits, candidate, current_hits);
+}
+
+bool page_map::verify(const pattern &signature, const uint8_t *base, const std::vector<uint32_t> &previous_hits, uint32_t candidate, std::vector<uint32_t> &current_hits) const
+{
+	current_hits.clear();
+
+	if (previous_hits.empty() || static_cast<size_t>(candidate) + signature.size() > image_size || !signature.match(base + candidate))
+	{
+		return false;
+	}
+
+	//unchanged content in front of the candidate must come from in front of the last previous hit
+	size_t previous_last = previous_hits.back();
+	size_t current_page = candidate / page_index::page_size;
+
+	if (previous_page_bound.at(current_page) >= static_cast<int64_t>(previous_last / page_index::page_size))
+	{
+		return false;
+	}
+
+	if (current_to_previous.at(current_page) != -1)
+	{
+		int64_t equivalent = static_cast<int64_t>(candidate) + (current_to_previous.at(current_page) - static_cast<int64_t>(current_page)) * static_cast<int64_t>(page_index::page_size);
+		if (equivalent > static_cast<int64_t>(previous_last))
+		{
+			return false;
+		}
+	}
+
+	std::vector<uint32_t> hits;
+
+	for (uint32_t hit : previous_hits)
+	{
+		uint32_t moved = 0;
+		if (this->move(signature, base, hit, moved) && moved < candidate)
+		{
+			hits.push_back(moved);
+		}
+	}
+
+	//only changed pages and seams can hold a new earlier hit
+	size_t overlap = signature.size() - 1;
+	for (const std::pair<size_t, size_t> &zone : dirty_zones)
+	{
+		if (zone.first >= candidate)
+		{
+			break;
+		}
+
+		size_t first = zone.first > overlap ? zone.first - overlap : 0;
+		size_t last = std::min<size_t>(std::min(zone.second + overlap, image_size), candidate + overlap);
+
+		for (const uint8_t *p : signature.find_all(base + first, base + last))
+		{
+			uint32_t offset = static_cast<uint32_t>(p - base);
+			if (offset < candidate)
+			{
+				hits.push_back(offset);
+			}
+		}
+	}
+
+	std::sort(hits.begin(), hits.end());
+	hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+
+	if (hits.size() != previous_hits.size() - 1)
+	{
+		return false;
+	}
+
+	current_hits.swap(hits);
+	current_hits.push_back(candidate);
+
+	return true;
+}
+
+bool page_map::get_shift(size_t previous_offset, int64_t &shift) const
+{
+	//a page edited in place usually keeps the shift of its neighbours
+	for (size_t page = previous_offset / page_index::page_size + 1; page != 0; --page)
+	{
+		if (page - 1 < previous_to_current.size() && previous_to_current.at(page - 1) != -1)
+		{
+			shift = (previous_to_current.at(page - 1) - static_cast<int64_t>(page - 1)) * static_cast<int64_t>(page_index::page_size);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool page_map::move(const pattern &signature, const uint8_t *base, uint32_t previous_hit, uint32_t &current_hit) const
+{
+	size_t first_page = previous_hit / page_index::page_size;
+	size_t last_page = (previous_hit + signature.size() - 1) / page_index::page_size;
+
+	if (last_page >= previous_to_current.size() || previous_to_current.at(first_page) == -1)
+	{
+		return false;
+	}
+
+	int64_t shift = previous_to_current.at(first_page) - static_cast<int64_t>(first_page);
+	for (size_t page = first_page; page <= last_page; ++page)
+	{
+		if (previous_to_current.at(page) - static_cast<int64_t>(page) != shift)
+		{
+			return false;
+		}
+	}
+
+	int64_t moved = static_cast<int64_t>(previous_hit) + shift * static_cast<int64_t>(page_index::page_size);
+	if (moved < 0 || static_cast<size_t>(moved) + signature.size() > image_size || !signature.match(base + moved))
+	{
+		return false;
+	}
+
+	current_hit = static_cast<uint32_t>(moved);
+	return true;
+}
+
+bool page_map::is_dirty(size_t page) const
+{
+	return page >= current_to_previous.size() || current_to_previous.at(page) == -1 || (page != 0 && current_to_previous.at(page - 1) != current_to_previous.at(page) - 1);
+}
+
+int64_t page_map::get_current_page(size_t previous_page) const
+{
+	return previous_page < previous_to_current.size() ? previous_to_current.at(previous_page) : -1;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "pattern.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//content hash of every page of an image
+class page_index
+{
+public:
+	enum : size_t
+	{
+		page_size = 0x1000
+	};
+
+	page_index();
+	page_index(const uint8_t *base, size_t size);
+	~page_index();
+
+	bool load(const std::string &path);
+	bool save(const std::string &path) const;
+
+	size_t size() const;
+	const std::vector<uint64_t> &get_hashes() const;
+
+	//identifies the build, equal for images with equal pages
+	uint64_t get_build() const;
+
+private:
+	size_t image_size;
+	std::vector<uint64_t> hashes;
+};
+
+//relates the pages of a previous build to the pages of the current one
+class page_map
+{
+public:
+	page_map(const page_index &previous, const page_index &current);
+	~page_map();
+
+	uint64_t get_previous_build() const;
+
+	//hits of the previous build without a scan, when their pages only shifted
+	bool carry(const pattern &signature, const uint8_t *base, const std::vector<uint32_t> &previous_hits, std::vector<uint32_t> &current_hits) const;
+
+	//proves candidate is hit previous_hits.size() by scanning what changed in front of it
+	bool verify(const pattern &signature, const uint8_t *base, const std::vector<uint32_t> &previous_hits, uint32_t candidate, std::vector<uint32_t> &current_hits) const;
+
+	//shift of the nearest unchanged page at or in front of a previous offset
+	bool get_shift(size_t previous_offset, int64_t &shift) const;
+
+	//changed, or next to a page that moved differently
+	bool is_dirty(size_t page) const;
+
+	//-1 if the page changed or is not unique
+	int64_t get_current_page(size_t previous_page) const;
+
+private:
+	//when every page the hit spans moved by the same amount
+	bool move(const pattern &signature, const uint8_t *base, uint32_t previous_hit, uint32_t &current_hit) const;
+
+	size_t image_size;
+	uint64_t previous_build;
+
+	std::vector<int64_t> previous_to_current;
+	std::vector<int64_t> current_to_previous;
+
+	//highest previous page in front of each current page
+	std::vector<int64_t> previous_page_bound;
+
+	//sorted, each zone is [first, second) in bytes
+	std::vector<std::pair<size_t, size_t>> dirty_zones;
+};
@@ -0,0 +1,1110 @@
+#include "pattern.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <deque>
+#include <set>
+#include <stdexcept>
+
+#include <emmintrin.h>
+
+pattern::pattern(const std::string &signature)
+	: anchor(0), second(0), min_size(0), max_size(0)
+{
+	std::vector<std::string> tokens = tokenize(signature);
+
+	size_t position = 0;
+	node root = parse_alternation(tokens, position);
+
+	if (position != tokens.size())
+	{
+		throw std::invalid_argument("pattern: unexpected " + tokens.at(position));
+	}
+
+	this->compile(root);
+}
+
+pattern::pattern(const node &root)
+	: anchor(0), second(0), min_size(0), max_size(0)
+{
+	this->compile(root);
+}
+
+void pattern::compile(const node &root)
+{
+	min_size = pattern_automaton::min_length(root);
+	max_size = pattern_automaton::max_length(root);
+
+	if (min_size == 0)
+	{
+		throw std::invalid_argument("pattern: empty signature");
+	}
+
+	text = format(root, true);
+
+	//long gaps of varying length split the signature into parts
+	if (root.type == node::node_sequence)
+	{
+		std::vector<node> run;
+		for (const node &child : root.children)
+		{
+			if (child.type != node::node_gap || child.min == child.max || child.max <= 64)
+			{
+				run.push_back(child);
+				continue;
+			}
+
+			if (run.empty())
+			{
+				throw std::invalid_argument("pattern: long gap without bytes before it");
+			}
+
+			parts.push_back(std::shared_ptr<const pattern>(new pattern(run.size() == 1 ? run.front() : node({node::node_sequence, byte_class(), 0, 0, run}))));
+			distances.push_back(std::make_pair(child.min, child.max));
+			run.clear();
+
+			//the next part is searched a fixed distance after this one ends
+			if (parts.back()->min_size != parts.back()->max_size)
+			{
+				throw std::invalid_argument("pattern: bytes before a long gap have to match a fixed length");
+			}
+		}
+
+		if (!parts.empty())
+		{
+			if (run.empty())
+			{
+				throw std::invalid_argument("pattern: long gap without bytes after it");
+			}
+
+			parts.push_back(std::shared_ptr<const pattern>(new pattern(run.size() == 1 ? run.front() : node({node::node_sequence, byte_class(), 0, 0, run}))));
+			return;
+		}
+	}
+
+	//a plain run of bytes, fixed gaps and masked classes compares with value and mask
+	std::vector<const node *> items;
+	if (root.type == node::node_sequence)
+	{
+		for (const node &child : root.children)
+		{
+			items.push_back(&child);
+		}
+	}
+	else
+	{
+		items.push_back(&root);
+	}
+
+	bool simple = true;
+	for (const node *item : items)
+	{
+		uint8_t value = 0, m = 0;
+		if (item->type == node::node_class && to_mask(item->bytes, value, m))
+		{
+			bytes.push_back(value);
+			mask.push_back(m);
+		}
+		else if (item->type == node::node_gap && item->min == item->max)
+		{
+			bytes.insert(bytes.end(), item->min, 0);
+			mask.insert(mask.end(), item->min, 0);
+		}
+		else
+		{
+			simple = false;
+			break;
+		}
+	}
+
+	if (!simple)
+	{
+		bytes.clear();
+		mask.clear();
+
+		//gaps up to a page keep the automaton small enough to build
+		if (max_size > 0x1000)
+		{
+			throw std::invalid_argument("pattern: match longer than 4096 bytes");
+		}
+
+		forward = std::make_shared<pattern_automaton>(root, false, true);
+		anchored = std::make_shared<pattern_automaton>(root, false, false);
+		backward = std::make_shared<pattern_automaton>(root, true, false);
+
+		return;
+	}
+
+	//bytes that show up everywhere in x86 code make poor anchors
+	static const uint8_t common[] = {0x00, 0xFF, 0xCC, 0x8B, 0x89, 0x48, 0xE8, 0x0F, 0x83, 0x45, 0x24, 0x50, 0x90};
+
+	//more compared bits first, then the rarer byte
+	auto weight = [&](size_t n) -> size_t {
+		size_t bits = 0;
+		for (uint8_t m = mask.at(n); m != 0; m >>= 1)
+		{
+			bits += m & 1;
+		}
+
+		return bits * 2 + (mask.at(n) == 0xFF && !memchr(common, bytes.at(n), sizeof(common)) ? 1 : 0);
+	};
+
+	anchor = bytes.size();
+	second = bytes.size();
+
+	for (size_t n = 0; n < bytes.size(); ++n)
+	{
+		if (mask.at(n) != 0 && (anchor == bytes.size() || weight(n) > weight(anchor)))
+		{
+			anchor = n;
+		}
+	}
+
+	for (size_t n = 0; n < bytes.size(); ++n)
+	{
+		if (n != anchor && mask.at(n) != 0 && (second == bytes.size() || weight(n) > weight(second)))
+		{
+			second = n;
+		}
+	}
+
+	//a single compared byte filters alone
+	if (second == bytes.size())
+	{
+		second = anchor;
+	}
+}
+
+pattern::~pattern()
+{
+}
+
+size_t pattern::size() const
+{
+	return forward || !parts.empty() ? max_size : bytes.size();
+}
+
+const std::vector<uint8_t> &pattern::get_bytes() const
+{
+	return bytes;
+}
+
+const std::vector<uint8_t> &pattern::get_mask() const
+{
+	return mask;
+}
+
+bool pattern::is_extended() const
+{
+	return forward != nullptr || !parts.empty();
+}
+
+std::string pattern::get_pattern() const
+{
+	if (this->is_extended())
+	{
+		return text;
+	}
+
+	std::string normalized;
+	normalized.reserve(bytes.size() * 3);
+
+	for (size_t n = 0; n < bytes.size(); ++n)
+	{
+		if (n != 0)
+		{
+			normalized += ' ';
+		}
+
+		byte_class members;
+		for (size_t b = 0; b < 256; ++b)
+		{
+			members.set(b, (b & mask.at(n)) == bytes.at(n));
+		}
+
+		normalized += format_class(members);
+	}
+
+	return normalized;
+}
+
+bool pattern::match(const uint8_t *p) const
+{
+	if (this->is_extended())
+	{
+		return this->match_within(p, p + max_size);
+	}
+
+	size_t n = 0;
+
+	//16 bytes per compare, the last block overlaps the one before it
+	if (bytes.size() >= 16)
+	{
+		for (;; n += 16)
+		{
+			n = std::min(n, bytes.size() - 16);
+
+			__m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + n));
+			__m128i masked = _mm_and_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask.data() + n)));
+
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(masked, _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes.data() + n)))) != 0xFFFF)
+			{
+				return false;
+			}
+
+			if (n + 16 == bytes.size())
+			{
+				return true;
+			}
+		}
+	}
+
+	for (; n < bytes.size(); ++n)
+	{
+		if ((p[n] & mask[n]) != bytes[n])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const uint8_t *pattern::find(const uint8_t *begin, const uint8_t *end, size_t n) const
+{
+	std::vector<const uint8_t *> hits = find_all(begin, end, n);
+	return n != 0 && hits.size() == n ? hits.back() : nullptr;
+}
+
+std::vector<const uint8_t *> pattern::find_all(const uint8_t *begin, const uint8_t *end, size_t limit) const
+{
+	std::vector<const uint8_t *> hits;
+
+	if (begin == nullptr || end <= begin || static_cast<size_t>(end - begin) < (this->is_extended() ? min_size : bytes.size()) || limit == 0)
+	{
+		return hits;
+	}
+
+	if (!parts.empty())
+	{
+		return this->find_parts(begin, end, limit);
+	}
+
+	if (forward)
+	{
+		//starts of matches ending at each position
+		std::set<size_t> pending;
+		size_t length = static_cast<size_t>(end - begin);
+
+		int32_t state = forward->start();
+		for (size_t n = 0; n < length; ++n)
+		{
+			state = forward->next(state, begin[n]);
+
+			if (forward->accepting(state))
+			{
+				int32_t reverse = backward->start();
+				for (size_t k = 0; k <= n && k < max_size; ++k)
+				{
+					reverse = backward->next(reverse, begin[n - k]);
+					if (reverse == pattern_automaton::dead_state)
+					{
+						break;
+					}
+
+					if (backward->accepting(reverse))
+					{
+						pending.insert(n - k);
+					}
+				}
+			}
+
+			while (!pending.empty() && *pending.begin() + max_size <= n + 1)
+			{
+				hits.push_back(begin + *pending.begin());
+				pending.erase(pending.begin());
+
+				if (hits.size() == limit)
+				{
+					return hits;
+				}
+			}
+		}
+
+		for (size_t start : pending)
+		{
+			hits.push_back(begin + start);
+
+			if (hits.size() == limit)
+			{
+				break;
+			}
+		}
+
+		return hits;
+	}
+
+	const uint8_t *last = end - bytes.size();
+
+	//all wildcards, every position is a hit
+	if (anchor == bytes.size())
+	{
+		for (const uint8_t *p = begin; p <= last && hits.size() < limit; ++p)
+		{
+			hits.push_back(p);
+		}
+
+		return hits;
+	}
+
+	//16 positions at once, only positions passing both anchors are matched
+	const __m128i anchor_mask = _mm_set1_epi8(static_cast<char>(mask[anchor]));
+	const __m128i anchor_value = _mm_set1_epi8(static_cast<char>(bytes[anchor]));
+	const __m128i second_mask = _mm_set1_epi8(static_cast<char>(mask[second]));
+	const __m128i second_value = _mm_set1_epi8(static_cast<char>(bytes[second]));
+
+	const uint8_t *p = begin;
+	for (; last - p >= 16; p += 16)
+	{
+		__m128i first = _mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + anchor)), anchor_mask), anchor_value);
+		__m128i next = _mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + second)), second_mask), second_value);
+
+		for (uint32_t candidates = _mm_movemask_epi8(_mm_and_si128(first, next)); candidates != 0; candidates &= candidates - 1)
+		{
+			size_t bit = 0;
+			while (!(candidates & (1u << bit)))
+			{
+				++bit;
+			}
+
+			if (match(p + bit))
+			{
+				hits.push_back(p + bit);
+
+				if (hits.size() == limit)
+				{
+					return hits;
+				}
+			}
+		}
+	}
+
+	for (; p <= last; ++p)
+	{
+		if (match(p))
+		{
+			hits.push_back(p);
+
+			if (hits.size() == limit)
+			{
+				break;
+			}
+		}
+	}
+
+	return hits;
+}
+
+std::vector<const uint8_t *> pattern::find_all_scalar(const uint8_t *begin, const uint8_t *end, size_t limit) const
+{
+	std::vector<const uint8_t *> hits;
+
+	if (begin == nullptr || end <= begin || static_cast<size_t>(end - begin) < (this->is_extended() ? min_size : bytes.size()) || limit == 0)
+	{
+		return hits;
+	}
+
+	if (this->is_extended())
+	{
+		for (const uint8_t *p = begin; p + min_size <= end; ++p)
+		{
+			if (this->match_within(p, end))
+			{
+				hits.push_back(p);
+
+				if (hits.size() == limit)
+				{
+					break;
+				}
+			}
+		}
+
+		return hits;
+	}
+
+	for (const uint8_t *p = begin, *last = end - bytes.size(); p <= last; ++p)
+	{
+		if (match(p))
+		{
+			hits.push_back(p);
+
+			if (hits.size() == limit)
+			{
+				break;
+			}
+		}
+	}
+
+	return hits;
+}
+
+std::vector<const uint8_t *> pattern::find_all(const uint8_t *begin, const uint8_t *end, const uint8_t *origin, const std::vector<uint64_t> &relocated, size_t limit) const
+{
+	if (this->is_extended() || relocated.empty() || anchor == bytes.size())
+	{
+		return this->find_all(begin, end, limit);
+	}
+
+	std::vector<const uint8_t *> hits;
+
+	if (begin == nullptr || end <= begin || static_cast<size_t>(end - begin) < bytes.size() || limit == 0)
+	{
+		return hits;
+	}
+
+	const uint8_t *last = end - bytes.size();
+
+	//a relocated anchor byte passes the compare whatever it holds
+	const __m128i anchor_mask = _mm_set1_epi8(static_cast<char>(mask[anchor]));
+	const __m128i anchor_value = _mm_set1_epi8(static_cast<char>(bytes[anchor]));
+	const __m128i second_mask = _mm_set1_epi8(static_cast<char>(mask[second]));
+	const __m128i second_value = _mm_set1_epi8(static_cast<char>(bytes[second]));
+
+	const uint8_t *p = begin;
+	for (; last - p >= 16; p += 16)
+	{
+		uint32_t first = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + anchor)), anchor_mask), anchor_value));
+		uint32_t next = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + second)), second_mask), second_value));
+
+		first |= get_bits(relocated, static_cast<size_t>(p + anchor - origin));
+		next |= get_bits(relocated, static_cast<size_t>(p + second - origin));
+
+		for (uint32_t candidates = first & next; candidates != 0; candidates &= candidates - 1)
+		{
+			size_t bit = 0;
+			while (!(candidates & (1u << bit)))
+			{
+				++bit;
+			}
+
+			if (this->match(p + bit, origin, relocated))
+			{
+				hits.push_back(p + bit);
+
+				if (hits.size() == limit)
+				{
+					return hits;
+				}
+			}
+		}
+	}
+
+	for (; p <= last; ++p)
+	{
+		if (this->match(p, origin, relocated))
+		{
+			hits.push_back(p);
+
+			if (hits.size() == limit)
+			{
+				break;
+			}
+		}
+	}
+
+	return hits;
+}
+
+bool pattern::match(const uint8_t *p, const uint8_t *origin, const std::vector<uint64_t> &relocated) const
+{
+	if (this->is_extended())
+	{
+		return this->match(p);
+	}
+
+	for (size_t k = 0; k < bytes.size(); ++k)
+	{
+		size_t n = static_cast<size_t>(p + k - origin);
+		if ((p[k] & mask[k]) != bytes[k] && !((n / 64) < relocated.size() && (relocated[n / 64] >> (n % 64)) & 1))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::vector<const uint8_t *> pattern::find_parts(const uint8_t *begin, const uint8_t *end, size_t limit) const
+{
+	std::vector<const uint8_t *> hits;
+
+	const size_t none = static_cast<size_t>(-1);
+	size_t length = static_cast<size_t>(end - begin);
+
+	auto next_hit = [&](size_t k, size_t from) -> size_t {
+		std::vector<const uint8_t *> next = from < length ? parts.at(k)->find_all(begin + from, end, 1) : std::vector<const uint8_t *>();
+		return next.empty() ? none : static_cast<size_t>(next.front() - begin);
+	};
+
+	//next hit of every part
+	std::vector<size_t> cursors(parts.size(), none);
+	cursors.at(0) = next_hit(0, 0);
+
+	//cursor of a part when its last window closed, 0 before it was searched
+	std::vector<size_t> parked(parts.size(), 0);
+
+	//(start, end of part k) waiting for part k + 1
+	std::vector<std::deque<std::pair<size_t, size_t>>> waiting(parts.size() - 1);
+
+	//held while an earlier partial match can still complete
+	std::set<size_t> found;
+
+	auto wait = [&](size_t k, size_t start, size_t part_end) {
+		if (waiting.at(k).empty())
+		{
+			size_t from = part_end + distances.at(k).first;
+			cursors.at(k + 1) = parked.at(k + 1) >= from ? parked.at(k + 1) : next_hit(k + 1, from);
+		}
+
+		waiting.at(k).push_back(std::make_pair(start, part_end));
+	};
+
+	for (;;)
+	{
+		size_t k = std::min_element(cursors.begin(), cursors.end()) - cursors.begin();
+		size_t position = cursors.at(k);
+
+		//no hit of the next part can fall into these windows any more
+		for (size_t i = 0; i < waiting.size(); ++i)
+		{
+			if (waiting.at(i).empty())
+			{
+				continue;
+			}
+
+			while (!waiting.at(i).empty() && waiting.at(i).front().second + distances.at(i).second < position)
+			{
+				waiting.at(i).pop_front();
+			}
+
+			//keep the hit past the window, it is the next one after any later window start
+			if (waiting.at(i).empty())
+			{
+				parked.at(i + 1) = cursors.at(i + 1);
+				cursors.at(i + 1) = none;
+			}
+		}
+
+		if (position != none && cursors.at(k) == position)
+		{
+			cursors.at(k) = next_hit(k, position + 1);
+
+			if (k == 0)
+			{
+				wait(0, position, position + parts.at(0)->size());
+			}
+			else
+			{
+				std::set<size_t> advanced;
+				std::vector<std::pair<size_t, size_t>> ready(waiting.at(k - 1).begin(), waiting.at(k - 1).end());
+
+				for (const std::pair<size_t, size_t> &partial : ready)
+				{
+					if (partial.second + distances.at(k - 1).first > position || !advanced.insert(partial.first).second)
+					{
+						continue;
+					}
+
+					if (k + 1 == parts.size())
+					{
+						found.insert(partial.first);
+					}
+					else
+					{
+						wait(k, partial.first, position + parts.at(k)->size());
+					}
+				}
+			}
+		}
+
+		//nothing that starts earlier can still complete
+		size_t earliest = cursors.at(0);
+		for (const std::deque<std::pair<size_t, size_t>> &stage : waiting)
+		{
+			for (const std::pair<size_t, size_t> &partial : stage)
+			{
+				earliest = std::min(earliest, partial.first);
+			}
+		}
+
+		while (!found.empty() && *found.begin() < earliest)
+		{
+			hits.push_back(begin + *found.begin());
+			found.erase(found.begin());
+
+			if (hits.size() == limit)
+			{
+				return hits;
+			}
+		}
+
+		if (position == none)
+		{
+			break;
+		}
+	}
+
+	return hits;
+}
+
+bool pattern::match_parts(size_t k, const uint8_t *p, const uint8_t *end) const
+{
+	if (!parts.at(k)->match_within(p, end))
+	{
+		return false;
+	}
+
+	if (k + 1 == parts.size())
+	{
+		return true;
+	}
+
+	const uint8_t *next = p + parts.at(k)->size();
+	for (size_t distance = distances.at(k).first; distance <= distances.at(k).second && distance < static_cast<size_t>(end - next); ++distance)
+	{
+		if (this->match_parts(k + 1, next + distance, end))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool pattern::match_within(const uint8_t *p, const uint8_t *end) const
+{
+	if (!parts.empty())
+	{
+		return this->match_parts(0, p, end);
+	}
+
+	if (forward)
+	{
+		return this->match_extended(p, std::min(end, p + max_size));
+	}
+
+	return static_cast<size_t>(end - p) >= bytes.size() && this->match(p);
+}
+
+bool pattern::match_extended(const uint8_t *p, const uint8_t *end) const
+{
+	int32_t state = anchored->start();
+	for (; p < end; ++p)
+	{
+		state = anchored->next(state, *p);
+		if (state == pattern_automaton::dead_state)
+		{
+			return false;
+		}
+
+		if (anchored->accepting(state))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::vector<std::string> pattern::tokenize(const std::string &signature)
+{
+	std::vector<std::string> tokens;
+	std::string token;
+	bool gap = false;
+
+	auto flush = [&]() {
+		//"8B45??" is split into pairs
+		if (gap || token.find_first_of("-&") != std::string::npos)
+		{
+			tokens.push_back(token);
+		}
+		else
+		{
+			for (size_t i = 0; i < token.size(); i += 2)
+			{
+				tokens.push_back(token.substr(i, 2));
+			}
+		}
+
+		token.clear();
+	};
+
+	for (char c : signature)
+	{
+		if (isspace(static_cast<uint8_t>(c)))
+		{
+			if (!token.empty())
+			{
+				flush();
+			}
+		}
+		else if (strchr("()|{}[]^", c))
+		{
+			if (!token.empty())
+			{
+				flush();
+			}
+
+			gap = c == '[' ? true : (c == ']' ? false : gap);
+			tokens.push_back(std::string(1, c));
+		}
+		else
+		{
+			token += c;
+		}
+	}
+
+	if (!token.empty())
+	{
+		flush();
+	}
+
+	return tokens;
+}
+
+pattern::node pattern::parse_alternation(const std::vector<std::string> &tokens, size_t &position)
+{
+	node alternation = {node::node_alternation, byte_class(), 0, 0, {}};
+	alternation.children.push_back(parse_sequence(tokens, position));
+
+	while (position < tokens.size() && tokens.at(position) == "|")
+	{
+		++position;
+		alternation.children.push_back(parse_sequence(tokens, position));
+	}
+
+	return alternation.children.size() == 1 ? alternation.children.front() : alternation;
+}
+
+pattern::node pattern::parse_sequence(const std::vector<std::string> &tokens, size_t &position)
+{
+	node sequence = {node::node_sequence, byte_class(), 0, 0, {}};
+
+	node item;
+	while (parse_item(tokens, position, item))
+	{
+		sequence.children.push_back(item);
+	}
+
+	return sequence.children.size() == 1 ? sequence.children.front() : sequence;
+}
+
+bool pattern::parse_item(const std::vector<std::string> &tokens, size_t &position, node &item)
+{
+	if (position == tokens.size())
+	{
+		return false;
+	}
+
+	const std::string &token = tokens.at(position);
+
+	if (token == "|" || token == ")")
+	{
+		return false;
+	}
+
+	auto expect = [&](const char *closing) {
+		if (position == tokens.size() || tokens.at(position) != closing)
+		{
+			throw std::invalid_argument(std::string("pattern: missing ") + closing);
+		}
+
+		++position;
+	};
+
+	++position;
+
+	if (token == "(")
+	{
+		item = parse_alternation(tokens, position);
+		expect(")");
+	}
+	else if (token == "{")
+	{
+		bool negate = position < tokens.size() && tokens.at(position) == "^";
+		position += negate ? 1 : 0;
+
+		item = {node::node_class, byte_class(), 0, 0, {}};
+		while (position < tokens.size() && tokens.at(position) != "}")
+		{
+			item.bytes |= parse_class(tokens.at(position++));
+		}
+		expect("}");
+
+		if (negate)
+		{
+			item.bytes.flip();
+		}
+
+		if (item.bytes.none())
+		{
+			throw std::invalid_argument("pattern: empty byte set");
+		}
+	}
+	else if (token == "[")
+	{
+		if (position == tokens.size())
+		{
+			throw std::invalid_argument("pattern: missing gap length");
+		}
+
+		//decimal lengths, "4" or "2-6"
+		const std::string &length = tokens.at(position++);
+		size_t separator = length.find('-');
+
+		if (length.empty() || length.find_first_not_of("0123456789-") != std::string::npos || separator == 0 || separator == length.size() - 1)
+		{
+			throw std::invalid_argument("pattern: invalid gap " + length);
+		}
+
+		item = {node::node_gap, byte_class(), 0, 0, {}};
+		item.min = std::stoul(length.substr(0, separator));
+		item.max = separator == std::string::npos ? item.min : std::stoul(length.substr(separator + 1));
+		expect("]");
+
+		if (item.min > item.max || item.max > 0x10000)
+		{
+			throw std::invalid_argument("pattern: invalid gap " + length);
+		}
+	}
+	else if (token == "^" || token == "}" || token == "]")
+	{
+		throw std::invalid_argument("pattern: unexpected " + token);
+	}
+	else
+	{
+		item = {node::node_class, parse_class(token), 0, 0, {}};
+	}
+
+	return true;
+}
+
+pattern::byte_class pattern::parse_class(const std::string &token)
+{
+	byte_class bytes;
+
+	auto parse_byte = [&](const std::string &t) -> size_t {
+		if (t.size() != 2 || !isxdigit(static_cast<uint8_t>(t.at(0))) || !isxdigit(static_cast<uint8_t>(t.at(1))))
+		{
+			throw std::invalid_argument("pattern: invalid byte " + t);
+		}
+
+		return std::stoul(t, nullptr, 16);
+	};
+
+	if (token == "?" || token == "??")
+	{
+		bytes.set();
+	}
+	else if (token.size() == 2 && (token.at(0) == '?') != (token.at(1) == '?'))
+	{
+		//nibble wildcard, "4?" or "?B"
+		bool high = token.at(1) == '?';
+		size_t value = parse_byte(high ? std::string(1, token.at(0)) + "0" : "0" + std::string(1, token.at(1)));
+		size_t m = high ? 0xF0 : 0x0F;
+
+		for (size_t b = 0; b < 256; ++b)
+		{
+			bytes.set(b, (b & m) == value);
+		}
+	}
+	else if (token.find('?') != std::string::npos)
+	{
+		throw std::invalid_argument("pattern: invalid wildcard " + token);
+	}
+	else if (token.find('&') != std::string::npos)
+	{
+		//value and mask, bits of the value outside the mask are ignored
+		size_t separator = token.find('&');
+		size_t m = parse_byte(token.substr(separator + 1));
+		size_t value = parse_byte(token.substr(0, separator)) & m;
+
+		for (size_t b = 0; b < 256; ++b)
+		{
+			bytes.set(b, (b & m) == value);
+		}
+	}
+	else if (token.find('-') != std::string::npos)
+	{
+		size_t separator = token.find('-');
+		size_t first = parse_byte(token.substr(0, separator));
+		size_t last = parse_byte(token.substr(separator + 1));
+
+		if (first > last)
+		{
+			throw std::invalid_argument("pattern: invalid range " + token);
+		}
+
+		for (size_t b = first; b <= last; ++b)
+		{
+			bytes.set(b);
+		}
+	}
+	else
+	{
+		bytes.set(parse_byte(token));
+	}
+
+	return bytes;
+}
+
+bool pattern::to_mask(const byte_class &bytes, uint8_t &value, uint8_t &mask)
+{
+	uint8_t all = 0xFF, any = 0;
+	for (size_t b = 0; b < 256; ++b)
+	{
+		if (bytes.test(b))
+		{
+			all &= static_cast<uint8_t>(b);
+			any |= static_cast<uint8_t>(b);
+		}
+	}
+
+	//bits every member agrees on
+	mask = static_cast<uint8_t>(~(all ^ any));
+	value = all & mask;
+
+	size_t free_bits = 0;
+	for (uint8_t m = static_cast<uint8_t>(~mask); m != 0; m >>= 1)
+	{
+		free_bits += m & 1;
+	}
+
+	return bytes.count() == (static_cast<size_t>(1) << free_bits);
+}
+
+std::string pattern::format(const node &n, bool top)
+{
+	switch (n.type)
+	{
+	case node::node_class:
+		return format_class(n.bytes);
+
+	case node::node_gap:
+		return "[" + std::to_string(n.min) + (n.min == n.max ? "" : "-" + std::to_string(n.max)) + "]";
+
+	case node::node_sequence:
+	{
+		std::string text;
+		for (const node &child : n.children)
+		{
+			text += (text.empty() ? "" : " ") + format(child, false);
+		}
+
+		return text;
+	}
+
+	case node::node_alternation:
+	{
+		std::string text;
+		for (const node &child : n.children)
+		{
+			text += (text.empty() ? "" : " | ") + format(child, false);
+		}
+
+		return top ? text : "(" + text + ")";
+	}
+	}
+
+	return "";
+}
+
+std::string pattern::format_class(const byte_class &bytes)
+{
+	static const char digits[] = "0123456789ABCDEF";
+
+	auto byte_text = [](size_t b) -> std::string {
+		return std::string({digits[b >> 4], digits[b & 0xF]});
+	};
+
+	if (bytes.all())
+	{
+		return "??";
+	}
+
+	uint8_t value = 0, mask = 0;
+	bool masked = to_mask(bytes, value, mask);
+
+	if (masked && mask == 0xF0)
+	{
+		return std::string({digits[value >> 4], '?'});
+	}
+
+	if (masked && mask == 0x0F)
+	{
+		return std::string({'?', digits[value & 0xF]});
+	}
+
+	//ranges, or the complement when it is shorter
+	auto runs = [&](const byte_class &members) -> std::vector<std::string> {
+		std::vector<std::string> items;
+		for (size_t b = 0; b < 256; ++b)
+		{
+			if (!members.test(b))
+			{
+				continue;
+			}
+
+			size_t last = b;
+			while (last + 1 < 256 && members.test(last + 1))
+			{
+				++last;
+			}
+
+			items.push_back(last == b ? byte_text(b) : byte_text(b) + "-" + byte_text(last));
+			b = last;
+		}
+
+		return items;
+	};
+
+	std::vector<std::string> items = runs(bytes);
+	if (items.size() == 1)
+	{
+		return items.front();
+	}
+
+	if (masked)
+	{
+		return byte_text(value) + "&" + byte_text(mask);
+	}
+
+	std::vector<std::string> excluded = runs(~bytes);
+	bool negate = excluded.size() < items.size();
+
+	std::string text = negate ? "{^" : "{";
+	for (const std::string &item : negate ? excluded : items)
+	{
+		text += (text.size() > 2 || (!negate && text.size() > 1) ? " " : "") + item;
+	}
+
+	return text + "}";
+}
+
+uint32_t pattern::get_bits(const std::vector<uint64_t> &relocated, size_t n)
+{
+	size_t word = n / 64, shift = n % 64;
+	if (word >= relocated.size())
+	{
+		return 0;
+	}
+
+	uint64_t bits = relocated[word] >> shift;
+	if (shift > 48 && word + 1 < relocated.size())
+	{
+		bits |= relocated[word + 1] << (64 - shift);
+	}
+
+	return static_cast<uint32_t>(bits & 0xFFFF);
+}
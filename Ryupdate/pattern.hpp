@@ -0,0 +1,109 @@
+#pragma once
+#include "pattern_automaton.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//byte signature ("8B 45 ?? E8"), compiled into values and a compare mask
+//
+//	8B			byte
+//	?? or ?		any byte
+//	4? or ?B	one nibble fixed, the other free
+//	05&C7		the bits set in the mask equal the value
+//	70-7F		byte range
+//	{8B 89}		byte set, {^CC} everything but the listed bytes
+//	[2-6]		2 to 6 bytes of anything, [4] exactly 4
+//	[0-512]		gaps longer than 64 bytes split the signature into parts, searched one after another
+//	(A | B)		alternatives, also allowed without parentheses at the top
+class pattern
+{
+public:
+	//throws std::invalid_argument on malformed signatures
+	pattern(const std::string &signature);
+	~pattern();
+
+	//longest match
+	size_t size() const;
+
+	//empty for extended patterns
+	const std::vector<uint8_t> &get_bytes() const;
+	const std::vector<uint8_t> &get_mask() const;
+
+	//matches vary in length, needs the automaton or parts
+	bool is_extended() const;
+
+	//normalized form, "8B 45 ?? E8"
+	std::string get_pattern() const;
+
+	//p must be followed by size() readable bytes
+	bool match(const uint8_t *p) const;
+
+	//match at p that does not read past end, for candidates tested one by one
+	bool match_within(const uint8_t *p, const uint8_t *end) const;
+
+	//n-th hit (one-based) inside [begin, end), nullptr if there are fewer hits
+	const uint8_t *find(const uint8_t *begin, const uint8_t *end, size_t n = 1) const;
+
+	//first limit hits inside [begin, end), in address order
+	std::vector<const uint8_t *> find_all(const uint8_t *begin, const uint8_t *end, size_t limit = static_cast<size_t>(-1)) const;
+
+	//same hits, compared at every position without the anchor
+	std::vector<const uint8_t *> find_all_scalar(const uint8_t *begin, const uint8_t *end, size_t limit = static_cast<size_t>(-1)) const;
+
+	//relocated bytes are not compared, bit n of relocated stands for origin + n
+	std::vector<const uint8_t *> find_all(const uint8_t *begin, const uint8_t *end, const uint8_t *origin, const std::vector<uint64_t> &relocated, size_t limit = static_cast<size_t>(-1)) const;
+
+	//p must be followed by size() readable bytes
+	bool match(const uint8_t *p, const uint8_t *origin, const std::vector<uint64_t> &relocated) const;
+
+private:
+	typedef pattern_automaton::node node;
+	typedef pattern_automaton::byte_class byte_class;
+
+	pattern(const node &root);
+	void compile(const node &root);
+
+	static std::vector<std::string> tokenize(const std::string &signature);
+
+	static node parse_alternation(const std::vector<std::string> &tokens, size_t &position);
+	static node parse_sequence(const std::vector<std::string> &tokens, size_t &position);
+	static bool parse_item(const std::vector<std::string> &tokens, size_t &position, node &item);
+	static byte_class parse_class(const std::string &token);
+
+	//value and mask of a class, false if the class is not every byte with those masked bits
+	static bool to_mask(const byte_class &bytes, uint8_t &value, uint8_t &mask);
+
+	static std::string format(const node &n, bool top);
+	static std::string format_class(const byte_class &bytes);
+
+	//single sweep over patterns made of parts
+	std::vector<const uint8_t *> find_parts(const uint8_t *begin, const uint8_t *end, size_t limit) const;
+	bool match_parts(size_t k, const uint8_t *p, const uint8_t *end) const;
+
+	bool match_extended(const uint8_t *p, const uint8_t *end) const;
+
+	//16 bits of relocated from bit n on, bits past its end are clear
+	static uint32_t get_bits(const std::vector<uint64_t> &relocated, size_t n);
+
+	std::vector<uint8_t> bytes;
+	std::vector<uint8_t> mask;
+
+	//the two bytes comparing the most bits
+	size_t anchor;
+	size_t second;
+
+	//forward finds where matches end, reverse where they start
+	std::shared_ptr<const pattern_automaton> forward;
+	std::shared_ptr<const pattern_automaton> anchored;
+	std::shared_ptr<const pattern_automaton> backward;
+
+	//parts and the range of bytes between each part and the next one
+	std::vector<std::shared_ptr<const pattern>> parts;
+	std::vector<std::pair<size_t, size_t>> distances;
+
+	size_t min_size;
+	size_t max_size;
+	std::string text;
+};
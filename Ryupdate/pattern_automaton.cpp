@@ -0,0 +1,256 @@
+#include "pattern_automaton.hpp"
+
+#include <algorithm>
+
+pattern_automaton::pattern_automaton(const node &root, bool reverse, bool unanchored)
+	: unanchored(unanchored), dfa_start(dead_state)
+{
+	int32_t match = this->insert(nfa_state::state_match, byte_class(), -1, -1);
+	nfa_start = this->compile(root, match, reverse);
+
+	this->closure(nfa_start, start_set);
+	std::sort(start_set.begin(), start_set.end());
+	start_set.erase(std::unique(start_set.begin(), start_set.end()), start_set.end());
+
+	//the dead state is always state 0
+	this->find_state(std::vector<int32_t>());
+	dfa_start = this->find_state(start_set);
+}
+
+pattern_automaton::~pattern_automaton()
+{
+}
+
+int32_t pattern_automaton::start() const
+{
+	return dfa_start;
+}
+
+int32_t pattern_automaton::next(int32_t state, uint8_t b) const
+{
+	int32_t known = dfa_next.at(static_cast<size_t>(state) * 256 + b);
+	if (known != -1)
+	{
+		return known;
+	}
+
+	std::vector<int32_t> set = unanchored ? start_set : std::vector<int32_t>();
+	for (int32_t s : dfa_sets.at(state))
+	{
+		if (nfa.at(s).type == nfa_state::state_class && nfa.at(s).bytes.test(b))
+		{
+			this->closure(nfa.at(s).out, set);
+		}
+	}
+
+	std::sort(set.begin(), set.end());
+	set.erase(std::unique(set.begin(), set.end()), set.end());
+
+	//past the limit the cache starts over, state ids other than the returned one go stale
+	if (dfa_sets.size() >= 0x1000 && dfa_index.find(set) == dfa_index.end())
+	{
+		dfa_sets.clear();
+		dfa_index.clear();
+		dfa_next.clear();
+		dfa_accepting.clear();
+
+		this->find_state(std::vector<int32_t>());
+		dfa_start = this->find_state(start_set);
+
+		return this->find_state(set);
+	}
+
+	int32_t target = this->find_state(set);
+	dfa_next.at(static_cast<size_t>(state) * 256 + b) = target;
+
+	return target;
+}
+
+bool pattern_automaton::accepting(int32_t state) const
+{
+	return dfa_accepting.at(state) != 0;
+}
+
+size_t pattern_automaton::min_length(const node &n)
+{
+	switch (n.type)
+	{
+	case node::node_class:
+		return 1;
+
+	case node::node_gap:
+		return n.min;
+
+	case node::node_sequence:
+	{
+		size_t length = 0;
+		for (const node &child : n.children)
+		{
+			length += min_length(child);
+		}
+
+		return length;
+	}
+
+	case node::node_alternation:
+	{
+		size_t length = static_cast<size_t>(-1);
+		for (const node &child : n.children)
+		{
+			length = std::min(length, min_length(child));
+		}
+
+		return n.children.empty() ? 0 : length;
+	}
+	}
+
+	return 0;
+}
+
+size_t pattern_automaton::max_length(const node &n)
+{
+	switch (n.type)
+	{
+	case node::node_class:
+		return 1;
+
+	case node::node_gap:
+		return n.max;
+
+	case node::node_sequence:
+	{
+		size_t length = 0;
+		for (const node &child : n.children)
+		{
+			length += max_length(child);
+		}
+
+		return length;
+	}
+
+	case node::node_alternation:
+	{
+		size_t length = 0;
+		for (const node &child : n.children)
+		{
+			length = std::max(length, max_length(child));
+		}
+
+		return length;
+	}
+	}
+
+	return 0;
+}
+
+int32_t pattern_automaton::compile(const node &n, int32_t next, bool reverse)
+{
+	//built back to front, every fragment is given the state it continues with
+	switch (n.type)
+	{
+	case node::node_class:
+		return this->insert(nfa_state::state_class, n.bytes, next, -1);
+
+	case node::node_gap:
+	{
+		byte_class any;
+		any.set();
+
+		int32_t state = next;
+		for (size_t k = n.min; k < n.max; ++k)
+		{
+			state = this->insert(nfa_state::state_split, byte_class(), this->insert(nfa_state::state_class, any, state, -1), next);
+		}
+
+		for (size_t k = 0; k < n.min; ++k)
+		{
+			state = this->insert(nfa_state::state_class, any, state, -1);
+		}
+
+		return state;
+	}
+
+	case node::node_sequence:
+	{
+		int32_t state = next;
+		if (reverse)
+		{
+			for (const node &child : n.children)
+			{
+				state = this->compile(child, state, reverse);
+			}
+		}
+		else
+		{
+			for (auto it = n.children.rbegin(); it != n.children.rend(); ++it)
+			{
+				state = this->compile(*it, state, reverse);
+			}
+		}
+
+		return state;
+	}
+
+	case node::node_alternation:
+	{
+		if (n.children.empty())
+		{
+			return next;
+		}
+
+		int32_t state = this->compile(n.children.back(), next, reverse);
+		for (size_t k = n.children.size() - 1; k != 0; --k)
+		{
+			state = this->insert(nfa_state::state_split, byte_class(), this->compile(n.children.at(k - 1), next, reverse), state);
+		}
+
+		return state;
+	}
+	}
+
+	return next;
+}
+
+int32_t pattern_automaton::insert(nfa_state::state_type type, const byte_class &bytes, int32_t out, int32_t out2)
+{
+	nfa.push_back({type, bytes, out, out2});
+	return static_cast<int32_t>(nfa.size() - 1);
+}
+
+void pattern_automaton::closure(int32_t state, std::vector<int32_t> &set) const
+{
+	//the nfa has no loops, gaps are bounded
+	if (nfa.at(state).type == nfa_state::state_split)
+	{
+		this->closure(nfa.at(state).out, set);
+		this->closure(nfa.at(state).out2, set);
+	}
+	else
+	{
+		set.push_back(state);
+	}
+}
+
+int32_t pattern_automaton::find_state(const std::vector<int32_t> &set) const
+{
+	auto it = dfa_index.find(set);
+	if (it != dfa_index.end())
+	{
+		return it->second;
+	}
+
+	bool match = false;
+	for (int32_t s : set)
+	{
+		match = match || nfa.at(s).type == nfa_state::state_match;
+	}
+
+	int32_t state = static_cast<int32_t>(dfa_sets.size());
+
+	dfa_sets.push_back(set);
+	dfa_index[set] = state;
+	dfa_next.resize(dfa_next.size() + 256, -1);
+	dfa_accepting.push_back(match ? 1 : 0);
+
+	return state;
+}
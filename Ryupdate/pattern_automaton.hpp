@@ -0,0 +1,84 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+//nfa of an extended pattern, dfa states are built as scans reach them
+class pattern_automaton
+{
+public:
+	typedef std::bitset<256> byte_class;
+
+	//sequences, alternatives, byte classes and gaps
+	struct node
+	{
+		enum node_type : uint32_t
+		{
+			node_sequence,
+			node_alternation,
+			node_class,
+			node_gap
+		};
+
+		node_type type;
+		byte_class bytes;
+		size_t min;
+		size_t max;
+		std::vector<node> children;
+	};
+
+	enum : int32_t
+	{
+		//no further byte can lead to a match
+		dead_state = 0
+	};
+
+	//reverse for the mirrored pattern, unanchored starts a match at every byte
+	pattern_automaton(const node &root, bool reverse, bool unanchored);
+	~pattern_automaton();
+
+	int32_t start() const;
+	int32_t next(int32_t state, uint8_t b) const;
+	bool accepting(int32_t state) const;
+
+	//shortest and longest match
+	static size_t min_length(const node &n);
+	static size_t max_length(const node &n);
+
+private:
+	struct nfa_state
+	{
+		enum state_type : uint32_t
+		{
+			state_class,
+			state_split,
+			state_match
+		};
+
+		state_type type;
+		byte_class bytes;
+		int32_t out;
+		int32_t out2;
+	};
+
+	int32_t compile(const node &n, int32_t next, bool reverse);
+	int32_t insert(nfa_state::state_type type, const byte_class &bytes, int32_t out, int32_t out2);
+
+	//reachable through splits, sorted
+	void closure(int32_t state, std::vector<int32_t> &set) const;
+	int32_t find_state(const std::vector<int32_t> &set) const;
+
+	std::vector<nfa_state> nfa;
+	int32_t nfa_start;
+	bool unanchored;
+
+	std::vector<int32_t> start_set;
+
+	//dfa states are dropped and rebuilt once there are too many of them
+	mutable std::vector<std::vector<int32_t>> dfa_sets;
+	mutable std::map<std::vector<int32_t>, int32_t> dfa_index;
+	mutable std::vector<int32_t> dfa_next;
+	mutable std::vector<uint8_t> dfa_accepting;
+	mutable int32_t dfa_start;
+};
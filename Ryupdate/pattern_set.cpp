@@ -0,0 +1,130 @@
+#include "pattern_set.hpp"
+
+#include <cstring>
+
+pattern_set::pattern_set(const std::vector<pattern> &patterns, const std::vector<size_t> &limits)
+	: patterns(patterns), limits(limits)
+{
+	std::vector<uint32_t> keys(patterns.size(), 0);
+	key_offsets.assign(patterns.size(), 0);
+	bucket_first.assign(0x10000 + 1, 0);
+
+	for (size_t n = 0; n < patterns.size(); ++n)
+	{
+		const std::vector<uint8_t> &bytes = patterns.at(n).get_bytes();
+
+		size_t key = get_key_offset(patterns.at(n));
+		key_offsets.at(n) = key;
+
+		if (key == unkeyed_offset)
+		{
+			unkeyed.push_back(static_cast<uint32_t>(n));
+			continue;
+		}
+
+		keys.at(n) = bytes.at(key) | (bytes.at(key + 1) << 8);
+		++bucket_first.at(keys.at(n) + 1);
+	}
+
+	for (size_t k = 0; k < 0x10000; ++k)
+	{
+		bucket_first.at(k + 1) += bucket_first.at(k);
+	}
+
+	bucket_items.resize(bucket_first.back());
+
+	std::vector<uint32_t> fill(bucket_first.begin(), bucket_first.end() - 1);
+	for (size_t n = 0; n < patterns.size(); ++n)
+	{
+		if (key_offsets.at(n) != unkeyed_offset)
+		{
+			bucket_items.at(fill.at(keys.at(n))++) = static_cast<uint32_t>(n);
+		}
+	}
+}
+
+pattern_set::~pattern_set()
+{
+}
+
+size_t pattern_set::get_key_offset(const pattern &compiled)
+{
+	static const uint8_t common[] = {0x00, 0xFF, 0xCC, 0x90};
+
+	const std::vector<uint8_t> &bytes = compiled.get_bytes();
+	const std::vector<uint8_t> &mask = compiled.get_mask();
+
+	//the first fixed pair that is not padding or zero fill, else any fixed pair
+	size_t key = unkeyed_offset;
+	for (size_t i = 0; i + 1 < bytes.size(); ++i)
+	{
+		if (mask.at(i) != 0xFF || mask.at(i + 1) != 0xFF)
+		{
+			continue;
+		}
+
+		if (key == unkeyed_offset)
+		{
+			key = i;
+		}
+
+		if (!memchr(common, bytes.at(i), sizeof(common)) || !memchr(common, bytes.at(i + 1), sizeof(common)))
+		{
+			return i;
+		}
+	}
+
+	return key;
+}
+
+size_t pattern_set::size() const
+{
+	return patterns.size();
+}
+
+std::vector<std::vector<const uint8_t *>> pattern_set::find_all(const uint8_t *begin, const uint8_t *end) const
+{
+	std::vector<std::vector<const uint8_t *>> hits(patterns.size());
+
+	if (begin == nullptr || end <= begin + 1)
+	{
+		return hits;
+	}
+
+	//the pass ends once every pattern has its hits
+	size_t pending = 0;
+	for (size_t n = 0; n < patterns.size(); ++n)
+	{
+		pending += limits.at(n) != 0 && key_offsets.at(n) != unkeyed_offset;
+	}
+
+	for (const uint8_t *p = begin; p + 1 < end && pending != 0; ++p)
+	{
+		uint32_t key = p[0] | (p[1] << 8);
+
+		for (uint32_t i = bucket_first[key]; i != bucket_first[key + 1]; ++i)
+		{
+			uint32_t n = bucket_items[i];
+			const pattern &candidate = patterns[n];
+
+			if (static_cast<size_t>(p - begin) < key_offsets[n] || hits[n].size() >= limits[n])
+			{
+				continue;
+			}
+
+			const uint8_t *start = p - key_offsets[n];
+			if (static_cast<size_t>(end - start) >= candidate.size() && candidate.match(start))
+			{
+				hits[n].push_back(start);
+				pending -= hits[n].size() == limits[n];
+			}
+		}
+	}
+
+	for (uint32_t n : unkeyed)
+	{
+		hits.at(n) = patterns.at(n).find_all(begin, end, limits.at(n));
+	}
+
+	return hits;
+}
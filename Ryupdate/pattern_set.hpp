@@ -0,0 +1,41 @@
+#pragma once
+#include "pattern.hpp"
+
+#include <cstdint>
+#include <vector>
+
+//many patterns in one pass, keyed by two fixed bytes
+class pattern_set
+{
+public:
+	//limit is the number of hits wanted per pattern
+	pattern_set(const std::vector<pattern> &patterns, const std::vector<size_t> &limits);
+	~pattern_set();
+
+	enum : size_t
+	{
+		unkeyed_offset = static_cast<size_t>(-1)
+	};
+
+	size_t size() const;
+
+	//unkeyed_offset without two neighbouring fixed bytes
+	static size_t get_key_offset(const pattern &compiled);
+
+	//hits per pattern, in the order they were given
+	std::vector<std::vector<const uint8_t *>> find_all(const uint8_t *begin, const uint8_t *end) const;
+
+private:
+	std::vector<pattern> patterns;
+	std::vector<size_t> limits;
+
+	//key offset per pattern
+	std::vector<size_t> key_offsets;
+
+	//bucket k is bucket_items[bucket_first[k], bucket_first[k + 1])
+	std::vector<uint32_t> bucket_first;
+	std::vector<uint32_t> bucket_items;
+
+	//scanned on their own
+	std::vector<uint32_t> unkeyed;
+};
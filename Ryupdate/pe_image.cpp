@@ -0,0 +1,313 @@
+#include "pe_image.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include <windows.h>
+
+pe_image::pe_image(const uint8_t *base, size_t size)
+{
+	if (base == nullptr || size < sizeof(IMAGE_DOS_HEADER))
+	{
+		return;
+	}
+
+	const IMAGE_DOS_HEADER *dos = reinterpret_cast<const IMAGE_DOS_HEADER *>(base);
+	if (dos->e_magic != IMAGE_DOS_SIGNATURE || dos->e_lfanew < 0 || static_cast<size_t>(dos->e_lfanew) + sizeof(IMAGE_NT_HEADERS) > size)
+	{
+		return;
+	}
+
+	const IMAGE_NT_HEADERS *nt = reinterpret_cast<const IMAGE_NT_HEADERS *>(base + dos->e_lfanew);
+	if (nt->Signature != IMAGE_NT_SIGNATURE)
+	{
+		return;
+	}
+
+	const IMAGE_SECTION_HEADER *header = IMAGE_FIRST_SECTION(nt);
+	size_t count = nt->FileHeader.NumberOfSections;
+
+	if (reinterpret_cast<const uint8_t *>(header + count) > base + size)
+	{
+		return;
+	}
+
+	for (size_t n = 0; n < count; ++n, ++header)
+	{
+		//names are padded to eight bytes and not terminated when they use all of them
+		char name[IMAGE_SIZEOF_SHORT_NAME + 1] = {0};
+		memcpy(name, header->Name, IMAGE_SIZEOF_SHORT_NAME);
+
+		sections.push_back({name, header->VirtualAddress, header->Misc.VirtualSize ? header->Misc.VirtualSize : header->SizeOfRawData, (header->Characteristics & (IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE)) != 0});
+	}
+
+	//the data directories sit further behind in 64-bit headers
+	bool wide = nt->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+	if (wide && static_cast<size_t>(dos->e_lfanew) + sizeof(IMAGE_NT_HEADERS64) > size)
+	{
+		return;
+	}
+
+	const IMAGE_DATA_DIRECTORY *directories = wide ? reinterpret_cast<const IMAGE_NT_HEADERS64 *>(nt)->OptionalHeader.DataDirectory : nt->OptionalHeader.DataDirectory;
+
+	this->load_imports(base, size, directories[IMAGE_DIRECTORY_ENTRY_IMPORT].VirtualAddress, wide);
+	this->load_exports(base, size, directories[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress, directories[IMAGE_DIRECTORY_ENTRY_EXPORT].Size);
+
+	const IMAGE_DATA_DIRECTORY &relocation = directories[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+	if (relocation.VirtualAddress != 0 && static_cast<size_t>(relocation.VirtualAddress) + relocation.Size <= size)
+	{
+		this->load_relocations(size, base + relocation.VirtualAddress, relocation.Size);
+	}
+
+	//only x64 images have .pdata
+	const IMAGE_DATA_DIRECTORY &exception = directories[IMAGE_DIRECTORY_ENTRY_EXCEPTION];
+	if (!wide || exception.VirtualAddress == 0 || static_cast<size_t>(exception.VirtualAddress) + exception.Size > size)
+	{
+		return;
+	}
+
+	//begin, end and unwind data, sorted by begin
+	for (size_t n = 0; n + 12 <= exception.Size; n += 12)
+	{
+		uint32_t entry[3] = {0, 0, 0};
+		memcpy(entry, base + exception.VirtualAddress + n, sizeof(entry));
+
+		if (entry[0] < entry[1] && entry[1] <= size)
+		{
+			runtime_functions.push_back({entry[0], entry[1]});
+		}
+	}
+}
+
+pe_image::~pe_image()
+{
+}
+
+const std::vector<pe_image::section> &pe_image::get_sections() const
+{
+	return sections;
+}
+
+const std::vector<pe_image::runtime_function> &pe_image::get_runtime_functions() const
+{
+	return runtime_functions;
+}
+
+const std::vector<uint64_t> &pe_image::get_relocations() const
+{
+	return relocations;
+}
+
+bool pe_image::is_relocated(size_t offset) const
+{
+	return (offset / 64) < relocations.size() && (relocations[offset / 64] >> (offset % 64)) & 1;
+}
+
+int64_t pe_image::find_import(const std::string &name) const
+{
+	size_t split = name.find('!');
+	if (split == std::string::npos)
+	{
+		return -1;
+	}
+
+	auto it = imports.find(get_module_name(name.substr(0, split)) + name.substr(split));
+	return it != imports.end() ? static_cast<int64_t>(it->second) : -1;
+}
+
+int64_t pe_image::find_export(const std::string &name) const
+{
+	auto it = exports.find(name);
+	return it != exports.end() ? static_cast<int64_t>(it->second) : -1;
+}
+
+const pe_image::section *pe_image::find_section(size_t offset) const
+{
+	for (const section &s : sections)
+	{
+		if (offset >= s.virtual_address && offset < static_cast<size_t>(s.virtual_address) + s.virtual_size)
+		{
+			return &s;
+		}
+	}
+
+	return nullptr;
+}
+
+const pe_image::section *pe_image::find_section(const std::string &name) const
+{
+	for (const section &s : sections)
+	{
+		if (s.name == name)
+		{
+			return &s;
+		}
+	}
+
+	return nullptr;
+}
+
+void pe_image::load_imports(const uint8_t *base, size_t size, uint32_t directory, bool wide)
+{
+	if (directory == 0)
+	{
+		return;
+	}
+
+	//64-bit thunks carry the ordinal flag in their top bit as well
+	size_t thunk_size = wide ? 8 : 4;
+	uint64_t ordinal_flag = wide ? 1ull << 63 : 1ull << 31;
+
+	for (size_t d = directory; d + sizeof(IMAGE_IMPORT_DESCRIPTOR) <= size; d += sizeof(IMAGE_IMPORT_DESCRIPTOR))
+	{
+		const IMAGE_IMPORT_DESCRIPTOR *descriptor = reinterpret_cast<const IMAGE_IMPORT_DESCRIPTOR *>(base + d);
+		if (descriptor->Name == 0 || descriptor->FirstThunk == 0)
+		{
+			break;
+		}
+
+		std::string module = get_module_name(read_string(base, size, descriptor->Name));
+
+		//the loader overwrites the first thunks, names are read from the original ones
+		size_t names = descriptor->OriginalFirstThunk != 0 ? descriptor->OriginalFirstThunk : descriptor->FirstThunk;
+
+		for (size_t k = 0;; ++k)
+		{
+			size_t entry = names + k * thunk_size, slot = descriptor->FirstThunk + k * thunk_size;
+			if (entry + thunk_size > size || slot + thunk_size > size)
+			{
+				break;
+			}
+
+			uint64_t thunk = 0;
+			memcpy(&thunk, base + entry, thunk_size);
+
+			if (thunk == 0)
+			{
+				break;
+			}
+
+			//named imports point to a hint followed by the name
+			std::string function = (thunk & ordinal_flag) != 0 ? "#" + std::to_string(thunk & 0xFFFF) : (thunk + 2 < size ? read_string(base, size, static_cast<size_t>(thunk) + 2) : "");
+			if (!function.empty())
+			{
+				imports[module + "!" + function] = static_cast<uint32_t>(slot);
+			}
+		}
+	}
+}
+
+void pe_image::load_exports(const uint8_t *base, size_t size, uint32_t directory, uint32_t length)
+{
+	if (directory == 0 || static_cast<size_t>(directory) + sizeof(IMAGE_EXPORT_DIRECTORY) > size)
+	{
+		return;
+	}
+
+	const IMAGE_EXPORT_DIRECTORY *exported = reinterpret_cast<const IMAGE_EXPORT_DIRECTORY *>(base + directory);
+
+	if (static_cast<size_t>(exported->AddressOfFunctions) + exported->NumberOfFunctions * 4ull > size || static_cast<size_t>(exported->AddressOfNames) + exported->NumberOfNames * 4ull > size ||
+		static_cast<size_t>(exported->AddressOfNameOrdinals) + exported->NumberOfNames * 2ull > size)
+	{
+		return;
+	}
+
+	const uint32_t *functions = reinterpret_cast<const uint32_t *>(base + exported->AddressOfFunctions);
+	const uint32_t *names = reinterpret_cast<const uint32_t *>(base + exported->AddressOfNames);
+	const uint16_t *ordinals = reinterpret_cast<const uint16_t *>(base + exported->AddressOfNameOrdinals);
+
+	//forwarded exports point into the directory
+	auto is_code = [&](uint32_t offset) { return offset != 0 && offset < size && (offset < directory || offset >= directory + length); };
+
+	for (size_t n = 0; n < exported->NumberOfFunctions; ++n)
+	{
+		if (is_code(functions[n]))
+		{
+			exports["#" + std::to_string(exported->Base + n)] = functions[n];
+		}
+	}
+
+	for (size_t n = 0; n < exported->NumberOfNames; ++n)
+	{
+		if (ordinals[n] < exported->NumberOfFunctions && is_code(functions[ordinals[n]]))
+		{
+			exports[read_string(base, size, names[n])] = functions[ordinals[n]];
+		}
+	}
+}
+
+void pe_image::load_relocations(size_t size, const uint8_t *directory, uint32_t length)
+{
+	relocations.assign((size + 63) / 64, 0);
+
+	//one block per page, 4 bits type and 12 bits offset per entry
+	for (size_t n = 0; n + sizeof(IMAGE_BASE_RELOCATION) <= length;)
+	{
+		const IMAGE_BASE_RELOCATION *block = reinterpret_cast<const IMAGE_BASE_RELOCATION *>(directory + n);
+		if (block->SizeOfBlock < sizeof(IMAGE_BASE_RELOCATION) || n + block->SizeOfBlock > length)
+		{
+			break;
+		}
+
+		for (size_t k = sizeof(IMAGE_BASE_RELOCATION); k + 2 <= block->SizeOfBlock; k += 2)
+		{
+			uint16_t entry = 0;
+			memcpy(&entry, directory + n + k, sizeof(entry));
+
+			size_t width = 0;
+			switch (entry >> 12)
+			{
+			case IMAGE_REL_BASED_HIGHLOW:
+				width = 4;
+				break;
+
+			case IMAGE_REL_BASED_DIR64:
+				width = 8;
+				break;
+
+			case IMAGE_REL_BASED_HIGH:
+			case IMAGE_REL_BASED_LOW:
+				width = 2;
+				break;
+
+			default:
+				//padding to the next block
+				continue;
+			}
+
+			size_t offset = static_cast<size_t>(block->VirtualAddress) + (entry & 0xFFF);
+			for (size_t b = offset; b < offset + width && b < size; ++b)
+			{
+				relocations[b / 64] |= 1ull << (b % 64);
+			}
+		}
+
+		n += block->SizeOfBlock;
+	}
+}
+
+std::string pe_image::read_string(const uint8_t *base, size_t size, size_t offset)
+{
+	if (offset >= size)
+	{
+		return "";
+	}
+
+	const uint8_t *end = static_cast<const uint8_t *>(memchr(base + offset, 0, size - offset));
+	return end != nullptr ? std::string(reinterpret_cast<const char *>(base + offset), static_cast<size_t>(end - base) - offset) : "";
+}
+
+std::string pe_image::get_module_name(const std::string &name)
+{
+	//KERNEL32.dll and kernel32 name the same module
+	std::string module = name;
+	std::transform(module.begin(), module.end(), module.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+
+	if (module.size() > 4 && module.compare(module.size() - 4, 4, ".dll") == 0)
+	{
+		module.resize(module.size() - 4);
+	}
+
+	return module;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//headers of a pe image mapped in memory, every offset is relative to the image base
+class pe_image
+{
+public:
+	struct section
+	{
+		std::string name;
+		uint32_t virtual_address;
+		uint32_t virtual_size;
+		bool executable;
+	};
+
+	//function extents of the exception directory, x64 images only
+	struct runtime_function
+	{
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	//an image without valid headers has no sections
+	pe_image(const uint8_t *base, size_t size);
+	~pe_image();
+
+	const std::vector<section> &get_sections() const;
+	const std::vector<runtime_function> &get_runtime_functions() const;
+
+	//one bit per byte the loader relocates, empty without .reloc
+	const std::vector<uint64_t> &get_relocations() const;
+	bool is_relocated(size_t offset) const;
+
+	//section holding offset, nullptr if none does
+	const section *find_section(size_t offset) const;
+	const section *find_section(const std::string &name) const;
+
+	//iat slot of "module!function" or "module!#ordinal", -1 if not imported
+	int64_t find_import(const std::string &name) const;
+
+	//-1 if not exported or forwarded
+	int64_t find_export(const std::string &name) const;
+
+private:
+	void load_imports(const uint8_t *base, size_t size, uint32_t directory, bool wide);
+	void load_exports(const uint8_t *base, size_t size, uint32_t directory, uint32_t length);
+	void load_relocations(size_t size, const uint8_t *directory, uint32_t length);
+
+	//terminated string at offset, empty if it runs past size
+	static std::string read_string(const uint8_t *base, size_t size, size_t offset);
+
+	//lower case, without .dll
+	static std::string get_module_name(const std::string &name);
+
+	std::vector<section> sections;
+	std::vector<runtime_function> runtime_functions;
+	std::vector<uint64_t> relocations;
+
+	//iat slots by "module!function", exported functions by name and "#ordinal"
+	std::unordered_map<std::string, uint32_t> imports;
+	std::unordered_map<std::string, uint32_t> exports;
+};
@@ -0,0 +1,130 @@
+#include "perfect_hash.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+perfect_hash::perfect_hash(const std::vector<std::string> &keys)
+{
+	size_t size = keys.size();
+
+	displacement.assign(size, 0);
+	slots.assign(size, "");
+
+	if (size == 0)
+	{
+		return;
+	}
+
+	std::vector<std::vector<size_t>> buckets(size);
+	for (size_t n = 0; n < size; ++n)
+	{
+		buckets.at(hash(0, keys.at(n).c_str(), keys.at(n).size()) % size).push_back(n);
+	}
+
+	std::vector<size_t> order(size);
+	for (size_t n = 0; n < size; ++n)
+	{
+		order.at(n) = n;
+	}
+
+	//place the largest buckets first, they are the hardest to fit
+	std::stable_sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) {
+		return buckets.at(a).size() > buckets.at(b).size();
+	});
+
+	std::vector<bool> used(size, false);
+	size_t n = 0;
+
+	for (; n < size && buckets.at(order.at(n)).size() > 1; ++n)
+	{
+		const std::vector<size_t> &bucket = buckets.at(order.at(n));
+
+		for (uint32_t seed = 1;; ++seed)
+		{
+			if (seed == 0)
+			{
+				throw std::runtime_error("perfect_hash: unable to find a displacement");
+			}
+
+			std::vector<size_t> candidate;
+			for (size_t key : bucket)
+			{
+				size_t slot = hash(seed, keys.at(key).c_str(), keys.at(key).size()) % size;
+				if (used.at(slot) || std::find(candidate.begin(), candidate.end(), slot) != candidate.end())
+				{
+					break;
+				}
+
+				candidate.push_back(slot);
+			}
+
+			if (candidate.size() == bucket.size())
+			{
+				for (size_t i = 0; i < bucket.size(); ++i)
+				{
+					used.at(candidate.at(i)) = true;
+					slots.at(candidate.at(i)) = keys.at(bucket.at(i));
+				}
+
+				displacement.at(order.at(n)) = static_cast<int32_t>(seed);
+				break;
+			}
+		}
+	}
+
+	//single key buckets go directly into the remaining free slots
+	size_t free_slot = 0;
+	for (; n < size && buckets.at(order.at(n)).size() == 1; ++n)
+	{
+		while (used.at(free_slot))
+		{
+			++free_slot;
+		}
+
+		used.at(free_slot) = true;
+		slots.at(free_slot) = keys.at(buckets.at(order.at(n)).at(0));
+
+		displacement.at(order.at(n)) = -static_cast<int32_t>(free_slot) - 1;
+	}
+}
+
+perfect_hash::~perfect_hash()
+{
+}
+
+uint32_t perfect_hash::hash(uint32_t seed, const char *key, size_t length)
+{
+	uint32_t h = seed ? seed : 0x811C9DC5;
+	for (size_t n = 0; n < length; ++n)
+	{
+		h = (h ^ static_cast<uint8_t>(key[n])) * 0x01000193;
+	}
+
+	return h;
+}
+
+size_t perfect_hash::index(const std::string &key) const
+{
+	if (displacement.empty())
+	{
+		return 0;
+	}
+
+	int32_t d = displacement.at(hash(0, key.c_str(), key.size()) % displacement.size());
+	if (d < 0)
+	{
+		return static_cast<size_t>(-d - 1);
+	}
+
+	return hash(static_cast<uint32_t>(d), key.c_str(), key.size()) % displacement.size();
+}
+
+const std::vector<int32_t> &perfect_hash::get_displacement() const
+{
+	return displacement;
+}
+
+const std::vector<std::string> &perfect_hash::get_slots() const
+{
+	return slots;
+}
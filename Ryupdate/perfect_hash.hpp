@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//minimal perfect hash (hash and displace), every key maps to a distinct slot in [0, size)
+class perfect_hash
+{
+public:
+	perfect_hash(const std::vector<std::string> &keys);
+	~perfect_hash();
+
+	//seeded fnv-1a, the generated lookup code must use the same function
+	static uint32_t hash(uint32_t seed, const char *key, size_t length);
+
+	size_t index(const std::string &key) const;
+
+	//displacement per bucket, negative values are -(slot + 1) for single key buckets
+	const std::vector<int32_t> &get_displacement() const;
+
+	//keys ordered by slot
+	const std::vector<std::string> &get_slots() const;
+
+private:
+	std::vector<int32_t> displacement;
+	std::vector<std::string> slots;
+};
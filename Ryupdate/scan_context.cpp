@@ -0,0 +1,408 @@
+#define NOMINMAX
+
+#include "scan_context.hpp"
+#include "pattern_set.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+scan_context::scan_context(const std::pair<address_t, size_t> &scan_region, const std::string &pages_path)
+	: region(scan_region),
+	  pages_path(pages_path),
+	  pages(reinterpret_cast<const uint8_t *>(scan_region.first), scan_region.second),
+	  image(reinterpret_cast<const uint8_t *>(scan_region.first), scan_region.second),
+	  strategy(scan_planner::strategy_anchor),
+	  job_count(0),
+	  cached_count(0),
+	  boundaries_built(false)
+{
+	//module.pages, module.boundaries
+	if (!pages_path.empty())
+	{
+		boundaries_path = pages_path.substr(0, pages_path.rfind('.')) + ".boundaries";
+	}
+
+	page_index previous;
+	if (!pages_path.empty() && previous.load(pages_path))
+	{
+		map = std::make_unique<page_map>(previous, pages);
+	}
+}
+
+scan_context::~scan_context()
+{
+}
+
+bool scan_context::save() const
+{
+	if (boundaries != nullptr && boundaries_built && !boundaries_path.empty())
+	{
+		boundaries->save(boundaries_path, pages.get_build());
+	}
+
+	return !pages_path.empty() && pages.save(pages_path);
+}
+
+address_t scan_context::get_address() const
+{
+	return region.first;
+}
+
+size_t scan_context::get_size() const
+{
+	return region.second;
+}
+
+const uint8_t *scan_context::get_base() const
+{
+	return reinterpret_cast<const uint8_t *>(region.first);
+}
+
+const page_index &scan_context::get_pages() const
+{
+	return pages;
+}
+
+const pe_image &scan_context::get_image() const
+{
+	return image;
+}
+
+const page_map *scan_context::get_page_map() const
+{
+	return map.get();
+}
+
+scan_planner::strategy scan_context::prescan(const std::vector<std::pair<std::string, size_t>> &batch, const scan_planner &planner)
+{
+	//rows sharing a pattern are one job, scanned for the most hits any of them wants
+	std::unordered_map<std::string, size_t> index;
+	std::vector<pattern> patterns;
+	std::vector<size_t> limits;
+
+	for (const std::pair<std::string, size_t> &p : batch)
+	{
+		try
+		{
+			pattern compiled(p.first);
+
+			auto it = index.insert(std::make_pair(compiled.get_pattern(), patterns.size()));
+			if (it.second)
+			{
+				patterns.push_back(compiled);
+				limits.push_back(p.second);
+			}
+			else
+			{
+				limits.at(it.first->second) = std::max(limits.at(it.first->second), p.second);
+			}
+		}
+		catch (std::exception &)
+		{
+		}
+	}
+
+	//patterns the context answers already are not scanned again
+	std::vector<pattern> pending;
+	std::vector<size_t> pending_limits;
+	std::vector<std::string> pending_keys;
+
+	for (const std::pair<std::string, size_t> &p : index)
+	{
+		size_t &limit = wanted[p.first];
+		limit = std::max(limit, limits.at(p.second));
+
+		auto it = scans.find(p.first);
+		if (it == scans.end() || (it->second.second < limits.at(p.second) && it->second.first.size() == it->second.second))
+		{
+			pending.push_back(patterns.at(p.second));
+			pending_limits.push_back(limits.at(p.second));
+			pending_keys.push_back(p.first);
+		}
+	}
+
+	scan_planner::strategy planned = planner.plan(patterns.size(), region.second, patterns.size() - pending.size());
+	strategy = planned == scan_planner::strategy_multi_pattern || planned == scan_planner::strategy_index ? planner.plan(1, region.second) : planned;
+
+	if (planned == scan_planner::strategy_multi_pattern)
+	{
+		std::vector<std::vector<const uint8_t *>> hits = pattern_set(pending, pending_limits).find_all(this->get_base(), this->get_base() + region.second);
+
+		for (size_t n = 0; n < pending.size(); ++n)
+		{
+			std::vector<uint32_t> offsets;
+			for (const uint8_t *hit : hits.at(n))
+			{
+				offsets.push_back(static_cast<uint32_t>(hit - this->get_base()));
+			}
+
+			scans[pending_keys.at(n)] = std::make_pair(offsets, pending_limits.at(n));
+		}
+	}
+
+	job_count = pending.size();
+	cached_count = patterns.size() - pending.size();
+	return planned;
+}
+
+std::vector<uint32_t> scan_context::find_all(const pattern &compiled, size_t limit, alignment align, bool relocatable)
+{
+	static const char *const prefixes[] = {"", "aligned ", "function "};
+
+	//aligned, function and relocatable scans keep their own entries
+	bool aligned = align == align_instruction;
+	std::string key = (relocatable ? "relocatable " : "") + (prefixes[align] + compiled.get_pattern());
+
+	const std::vector<uint64_t> &relocated = image.get_relocations();
+	relocatable = relocatable && !relocated.empty();
+
+	//an earlier scan answers when it asked for as many hits or found fewer
+	auto it = scans.find(key);
+	if (it == scans.end() || (it->second.second < limit && it->second.first.size() == it->second.second))
+	{
+		auto w = wanted.find(compiled.get_pattern());
+		size_t scan_limit = w != wanted.end() && align == align_none && !relocatable ? std::max(limit, w->second) : limit;
+
+		const uint8_t *base = this->get_base();
+		const uint8_t *end = base + region.second;
+
+		std::vector<uint32_t> offsets;
+
+		//a few thousand function starts are tested instead of every byte
+		if (align == align_function)
+		{
+			for (const function_index::function &f : this->get_functions().get_functions())
+			{
+				if (offsets.size() == scan_limit)
+				{
+					break;
+				}
+
+				bool matched = relocatable ? static_cast<size_t>(end - base) - f.begin >= compiled.size() && compiled.match(base + f.begin, base, relocated) : compiled.match_within(base + f.begin, end);
+				if (matched)
+				{
+					offsets.push_back(f.begin);
+				}
+			}
+		}
+		else
+		{
+			for (const uint8_t *from = base; from < end && offsets.size() < scan_limit;)
+			{
+				std::vector<const uint8_t *> hits;
+				if (relocatable)
+				{
+					hits = compiled.find_all(from, end, base, relocated, scan_limit - offsets.size());
+				}
+				else
+				{
+					hits = strategy == scan_planner::strategy_scalar ? compiled.find_all_scalar(from, end, scan_limit - offsets.size()) : compiled.find_all(from, end, scan_limit - offsets.size());
+				}
+
+				for (const uint8_t *hit : hits)
+				{
+					//hits inside an instruction are dropped
+					if (!aligned || this->get_boundaries().is_boundary(static_cast<size_t>(hit - base)))
+					{
+						offsets.push_back(static_cast<uint32_t>(hit - base));
+					}
+				}
+
+				from = aligned && !hits.empty() ? hits.back() + 1 : end;
+			}
+		}
+
+		scans[key] = std::make_pair(offsets, scan_limit);
+		it = scans.find(key);
+	}
+
+	const std::vector<uint32_t> &hits = it->second.first;
+	return std::vector<uint32_t>(hits.begin(), hits.begin() + std::min(limit, hits.size()));
+}
+
+const boundary_map &scan_context::get_boundaries()
+{
+	//saved per build
+	if (boundaries == nullptr)
+	{
+		boundaries = std::make_unique<boundary_map>();
+		boundaries_built = boundaries_path.empty() || !boundaries->load(boundaries_path, pages.get_build());
+
+		if (boundaries_built)
+		{
+			boundaries = std::make_unique<boundary_map>(this->get_base(), region.second, image);
+		}
+	}
+
+	return *boundaries;
+}
+
+const function_index &scan_context::get_functions()
+{
+	//x64 images list their functions, x86 ones are guessed from the instruction starts
+	if (functions == nullptr)
+	{
+		if (!image.get_runtime_functions().empty())
+		{
+			functions = std::make_unique<function_index>(image);
+		}
+		else
+		{
+			functions = std::make_unique<function_index>(this->get_base(), region.second, image, this->get_boundaries());
+		}
+	}
+
+	return *functions;
+}
+
+bool scan_context::has_functions() const
+{
+	return functions != nullptr || !image.get_runtime_functions().empty();
+}
+
+const xref_index &scan_context::get_references()
+{
+	if (references == nullptr)
+	{
+		references = std::make_unique<xref_index>(this->get_base(), region.second, image, this->get_boundaries());
+	}
+
+	return *references;
+}
+
+const string_index &scan_context::get_strings()
+{
+	if (strings == nullptr)
+	{
+		strings = std::make_unique<string_index>(this->get_base(), region.second, image);
+	}
+
+	return *strings;
+}
+
+size_t scan_context::get_job_count() const
+{
+	return job_count;
+}
+
+size_t scan_context::get_cached_count() const
+{
+	return cached_count;
+}
+
+const scan_context::decoding &scan_context::disassemble(address_t address, size_t length)
+{
+	//a longer read replaces a shorter one, it decodes the same instructions and more
+	decoding &decoded = decodings[address];
+	if (decoded.disassembly == nullptr || decoded.length < length)
+	{
+		decoded.disassembly = std::make_shared<disassembler>(address, z.readmemory(address, length));
+		decoded.instructions = decoded.disassembly->get_instructions();
+		decoded.length = length;
+	}
+
+	return decoded;
+}
+
+bool scan_context::decode(address_t address, size_t index, x86_decoder::instruction &decoded, bool operands) const
+{
+	if (address < region.first || address - region.first >= region.second)
+	{
+		return false;
+	}
+
+	size_t offset = address - region.first;
+
+	for (size_t n = 0; n < index; ++n)
+	{
+		size_t length = x86_decoder::get_length(this->get_base() + offset, region.second - offset);
+		if (length == 0)
+		{
+			return false;
+		}
+
+		offset += length;
+	}
+
+	if (operands)
+	{
+		return x86_decoder::decode(this->get_base() + offset, region.second - offset, static_cast<address_t>(region.first + offset), decoded);
+	}
+
+	decoded.address = static_cast<address_t>(region.first + offset);
+	decoded.length = x86_decoder::get_length(this->get_base() + offset, region.second - offset);
+	decoded.mnemonic = nullptr;
+	decoded.op_count = 0;
+
+	return decoded.length != 0;
+}
+
+size_t scan_context::get_function_end(size_t offset)
+{
+	const function_index::function *f = this->get_functions().find(offset);
+	if (f != nullptr)
+	{
+		return std::min(static_cast<size_t>(f->end), region.second);
+	}
+
+	const uint8_t *base = this->get_base();
+
+	//never past the section or 64 kb
+	size_t last = std::min(region.second, offset + 0x10000);
+
+	const pe_image::section *s = image.find_section(offset);
+	if (s != nullptr)
+	{
+		last = std::min(last, static_cast<size_t>(s->virtual_address) + s->virtual_size);
+	}
+
+	for (size_t n = offset; n + 1 < last; ++n)
+	{
+		const uint8_t *p = static_cast<const uint8_t *>(memchr(base + n, 0xCC, last - n - 1));
+		if (p == nullptr)
+		{
+			break;
+		}
+
+		n = static_cast<size_t>(p - base);
+		if (p[1] == 0xCC || (n != offset && p[-1] == 0xC3))
+		{
+			return n;
+		}
+	}
+
+	return last;
+}
+
+int64_t scan_context::predict(const std::string &section, uint32_t section_offset) const
+{
+	const pe_image::section *s = image.find_section(section);
+	if (s == nullptr)
+	{
+		return -1;
+	}
+
+	int64_t delta = 0;
+
+	//median, rows of a rewritten function do not drag it
+	auto it = section_deltas.find(section);
+	if (it != section_deltas.end() && !it->second.empty())
+	{
+		std::vector<int64_t> deltas = it->second;
+		std::nth_element(deltas.begin(), deltas.begin() + deltas.size() / 2, deltas.end());
+		delta = deltas.at(deltas.size() / 2);
+	}
+
+	int64_t offset = static_cast<int64_t>(s->virtual_address) + section_offset + delta;
+	return offset >= 0 && static_cast<size_t>(offset) < region.second ? offset : -1;
+}
+
+void scan_context::observe(const std::string &section, uint32_t section_offset, uint32_t offset)
+{
+	//rows that moved to another section say nothing about either
+	const pe_image::section *s = image.find_section(offset);
+	if (s != nullptr && s->name == section)
+	{
+		section_deltas[section].push_back(static_cast<int64_t>(offset) - static_cast<int64_t>(s->virtual_address) - section_offset);
+	}
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include "zephyrus.hpp"
+#include "page_index.hpp"
+#include "pe_image.hpp"
+#include "boundary_map.hpp"
+#include "function_index.hpp"
+#include "xref_index.hpp"
+#include "string_index.hpp"
+#include "scan_planner.hpp"
+#include "disassembler.hpp"
+#include "x86_decoder.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//state shared by the scan passes over one build of a region
+class scan_context
+{
+public:
+	//pages_path holds the page hashes of the previous pass, empty to scan without them
+	scan_context(const std::pair<address_t, size_t> &scan_region, const std::string &pages_path = "");
+	~scan_context();
+
+	//stores the page hashes of this pass for the next one
+	bool save() const;
+
+	address_t get_address() const;
+	size_t get_size() const;
+	const uint8_t *get_base() const;
+
+	const page_index &get_pages() const;
+	const pe_image &get_image() const;
+
+	//nullptr without page hashes of a previous pass
+	const page_map *get_page_map() const;
+
+	//(signature, result) pairs of rows without earlier hits, in one pass when that is cheaper
+	scan_planner::strategy prescan(const std::vector<std::pair<std::string, size_t>> &batch, const scan_planner &planner);
+
+	//where hits may start
+	enum alignment : uint32_t
+	{
+		align_none,
+		align_instruction,
+
+		//only the starts of the function index are tested
+		align_function
+	};
+
+	//first limit hits as offsets, every pattern is scanned once per context
+	std::vector<uint32_t> find_all(const pattern &compiled, size_t limit, alignment align = align_none, bool relocatable = false);
+
+	//decoded on first use
+	const boundary_map &get_boundaries();
+
+	//built on first use
+	const function_index &get_functions();
+
+	//true when get_functions does not sweep the image
+	bool has_functions() const;
+
+	//built on first use
+	const xref_index &get_references();
+
+	//built on first use
+	const string_index &get_strings();
+
+	//distinct patterns the last prescan batch scanned, and those it found cached
+	size_t get_job_count() const;
+	size_t get_cached_count() const;
+
+	struct decoding
+	{
+		std::shared_ptr<disassembler> disassembly;
+		std::vector<instruction> instructions;
+		size_t length;
+	};
+
+	//decoded once for every row reading from the same place
+	const decoding &disassemble(address_t address, size_t length);
+
+	//index-th instruction from address without capstone, false if an encoding on the way is not covered
+	bool decode(address_t address, size_t index, x86_decoder::instruction &decoded, bool operands = true) const;
+
+	//from the function index, or the int3 padding behind offset
+	size_t get_function_end(size_t offset);
+
+	//where a hit of the previous build is expected, -1 if the section is gone
+	int64_t predict(const std::string &section, uint32_t section_offset) const;
+
+	//learns how far a section moved
+	void observe(const std::string &section, uint32_t section_offset, uint32_t offset);
+
+private:
+	std::pair<address_t, size_t> region;
+	std::string pages_path;
+
+	page_index pages;
+	pe_image image;
+	std::unique_ptr<page_map> map;
+
+	//engine for patterns scanned on their own
+	scan_planner::strategy strategy;
+	size_t job_count;
+	size_t cached_count;
+
+	//hits per normalized pattern, and how many were asked for
+	std::unordered_map<std::string, std::pair<std::vector<uint32_t>, size_t>> scans;
+
+	//most hits any row of the batch wants per normalized pattern
+	std::unordered_map<std::string, size_t> wanted;
+
+	std::unordered_map<address_t, decoding> decodings;
+
+	//stored next to the page hashes, only rebuilt for a new build
+	std::unique_ptr<boundary_map> boundaries;
+	std::string boundaries_path;
+	bool boundaries_built;
+
+	std::unique_ptr<function_index> functions;
+	std::unique_ptr<xref_index> references;
+	std::unique_ptr<string_index> strings;
+
+	//how far the rows of each section moved
+	std::map<std::string, std::vector<int64_t>> section_deltas;
+};
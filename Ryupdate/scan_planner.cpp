@@ -0,0 +1,210 @@
+#include "scan_planner.hpp"
+#include "pattern_set.hpp"
+#include "json.hpp"
+
+#include <chrono>
+#include <functional>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using namespace nlohmann;
+
+scan_planner::scan_planner()
+	: calibrated(false), scalar_cost(1.0), anchor_cost(0.1), multi_cost(1.5), multi_pattern_cost(0.002)
+{
+}
+
+scan_planner::~scan_planner()
+{
+}
+
+void scan_planner::calibrate()
+{
+	//zero and int3 fill make anchors collide as in real images
+	std::mt19937 random(0x52595550);
+	std::vector<uint8_t> image(4 * 1024 * 1024);
+
+	for (uint8_t &b : image)
+	{
+		uint32_t r = random();
+		b = (r & 0xF) < 3 ? 0x00 : ((r & 0xF) == 3 ? 0xCC : static_cast<uint8_t>(r >> 8));
+	}
+
+	//patterns cut from the image, so each has hits and is compared all the way
+	std::vector<pattern> patterns;
+	for (size_t n = 0; n < 64; ++n)
+	{
+		size_t offset = random() % (image.size() - 16);
+		std::string text;
+		for (size_t i = 0; i < 12; ++i)
+		{
+			static const char digits[] = "0123456789ABCDEF";
+			text += i % 5 == 4 ? std::string("??") : std::string({digits[image.at(offset + i) >> 4], digits[image.at(offset + i) & 0xF]});
+			text += ' ';
+		}
+
+		patterns.push_back(pattern(text));
+	}
+
+	const uint8_t *begin = image.data();
+	const uint8_t *end = image.data() + image.size();
+
+	//nanoseconds per byte of the fastest of three runs
+	auto measure = [&](const std::function<void()> &run) -> double {
+		double best = 0;
+		for (size_t n = 0; n < 3; ++n)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			run();
+			double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+			best = n == 0 || elapsed < best ? elapsed : best;
+		}
+
+		return best / static_cast<double>(image.size());
+	};
+
+	size_t sink = 0;
+
+	scalar_cost = measure([&]() {
+		sink += patterns.front().find_all_scalar(begin, end).size();
+	});
+
+	anchor_cost = measure([&]() {
+		for (size_t n = 0; n < 8; ++n)
+		{
+			sink += patterns.at(n).find_all(begin, end).size();
+		}
+	}) / 8;
+
+	pattern_set one(std::vector<pattern>(patterns.begin(), patterns.begin() + 1), std::vector<size_t>(1, static_cast<size_t>(-1)));
+	pattern_set all(patterns, std::vector<size_t>(patterns.size(), static_cast<size_t>(-1)));
+
+	double single = measure([&]() {
+		sink += one.find_all(begin, end).size();
+	});
+
+	double batch = measure([&]() {
+		sink += all.find_all(begin, end).size();
+	});
+
+	multi_cost = single;
+	multi_pattern_cost = batch > single ? (batch - single) / static_cast<double>(patterns.size() - 1) : 0;
+
+	//the hit counts keep the runs from being optimized away
+	static volatile size_t hits;
+	hits = sink;
+
+	calibrated = true;
+}
+
+bool scan_planner::is_calibrated() const
+{
+	return calibrated;
+}
+
+bool scan_planner::load(const std::string &path)
+{
+	std::ifstream fs(path);
+	if (!fs.is_open())
+	{
+		return false;
+	}
+
+	try
+	{
+		json j;
+		fs >> j;
+
+		scalar_cost = j.at("scalar").get<double>();
+		anchor_cost = j.at("anchor").get<double>();
+		multi_cost = j.at("multi").get<double>();
+		multi_pattern_cost = j.at("multi_pattern").get<double>();
+	}
+	catch (std::exception &)
+	{
+		return false;
+	}
+
+	calibrated = true;
+	return true;
+}
+
+bool scan_planner::save(const std::string &path) const
+{
+	json j;
+	j["scalar"] = scalar_cost;
+	j["anchor"] = anchor_cost;
+	j["multi"] = multi_cost;
+	j["multi_pattern"] = multi_pattern_cost;
+
+	std::ofstream fs(path, std::ios::trunc);
+	fs << j.dump(4);
+
+	return static_cast<bool>(fs);
+}
+
+scan_planner::strategy scan_planner::plan(size_t count, size_t size, size_t cached) const
+{
+	if (count != 0 && cached >= count)
+	{
+		return strategy_index;
+	}
+
+	count -= cached;
+	strategy best = strategy_scalar;
+
+	for (strategy s : {strategy_anchor, strategy_multi_pattern})
+	{
+		if (this->estimate(s, count, size) < this->estimate(best, count, size))
+		{
+			best = s;
+		}
+	}
+
+	return best;
+}
+
+double scan_planner::estimate(strategy s, size_t count, size_t size) const
+{
+	double bytes = static_cast<double>(size);
+	double patterns = static_cast<double>(count);
+
+	switch (s)
+	{
+	case strategy_scalar:
+		return patterns * bytes * scalar_cost / 1e6;
+
+	case strategy_anchor:
+		return patterns * bytes * anchor_cost / 1e6;
+
+	case strategy_multi_pattern:
+		return count == 0 ? 0 : bytes * (multi_cost + patterns * multi_pattern_cost) / 1e6;
+
+	case strategy_index:
+		return 0;
+	}
+
+	return 0;
+}
+
+const char *scan_planner::get_name(strategy s)
+{
+	switch (s)
+	{
+	case strategy_scalar:
+		return "scalar";
+
+	case strategy_anchor:
+		return "anchor";
+
+	case strategy_multi_pattern:
+		return "multi-pattern";
+
+	case strategy_index:
+		return "index";
+	}
+
+	return "unknown";
+}
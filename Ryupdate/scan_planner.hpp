@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+//picks the scan engine from costs measured on this machine
+class scan_planner
+{
+public:
+	enum strategy : uint32_t
+	{
+		//every position compared
+		strategy_scalar,
+		//sse2 compare of two anchor bytes, then compared
+		strategy_anchor,
+		//one pass for the whole batch, keyed by two bytes
+		strategy_multi_pattern,
+		//every hit cached by the context
+		strategy_index
+	};
+
+	//uncalibrated planners use costs typical of a desktop machine
+	scan_planner();
+	~scan_planner();
+
+	//takes a few hundred milliseconds
+	void calibrate();
+	bool is_calibrated() const;
+
+	bool load(const std::string &path);
+	bool save(const std::string &path) const;
+
+	//cached of the count patterns are answered by the context
+	strategy plan(size_t count, size_t size, size_t cached = 0) const;
+
+	//estimated milliseconds
+	double estimate(strategy s, size_t count, size_t size) const;
+
+	static const char *get_name(strategy s);
+
+private:
+	bool calibrated;
+
+	//nanoseconds per byte for one pattern
+	double scalar_cost;
+	double anchor_cost;
+
+	//per byte of a pass, and what every pattern adds
+	double multi_cost;
+	double multi_pattern_cost;
+};
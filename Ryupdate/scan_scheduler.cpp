@@ -0,0 +1,131 @@
+#include "scan_scheduler.hpp"
+
+#include <chrono>
+
+#include <QTimer>
+
+scan_scheduler::scan_scheduler(const order_function_t &order, const progress_function_t &progress)
+	: order(order), progress(progress), timer(std::make_unique<QTimer>()), total(0)
+{
+	//0 ms fires whenever the event loop has nothing else to do
+	this->timer->setInterval(0);
+
+	QObject::connect(this->timer.get(), &QTimer::timeout, [this]() {
+		this->step();
+	});
+}
+
+scan_scheduler::~scan_scheduler()
+{
+	this->timer->stop();
+}
+
+void scan_scheduler::start(const std::shared_ptr<scan_context> &context, const std::vector<std::string> &names)
+{
+	this->stop();
+
+	this->context = context;
+	this->background.assign(names.begin(), names.end());
+	this->total = names.size();
+
+	this->progress(0, this->total);
+	this->timer->start();
+}
+
+void scan_scheduler::stop()
+{
+	this->timer->stop();
+
+	this->context.reset();
+	this->visible.clear();
+	this->background.clear();
+	this->done.clear();
+	this->total = 0;
+}
+
+bool scan_scheduler::is_running() const
+{
+	return this->context != nullptr;
+}
+
+void scan_scheduler::prioritize(const std::vector<std::string> &names)
+{
+	//taken from the back, top row first
+	this->visible.assign(names.rbegin(), names.rend());
+}
+
+void scan_scheduler::resolve(const std::vector<std::string> &names)
+{
+	if (!this->is_running())
+	{
+		return;
+	}
+
+	for (const std::string &name : names)
+	{
+		this->update(name);
+	}
+
+	this->progress(this->done.size(), this->total);
+
+	if (this->done.size() >= this->total)
+	{
+		this->finish();
+	}
+}
+
+void scan_scheduler::step()
+{
+	//a slice short enough that scrolling and typing stay responsive
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(15);
+
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		if (!this->visible.empty())
+		{
+			this->update(this->visible.back());
+			this->visible.pop_back();
+		}
+		else if (!this->background.empty())
+		{
+			this->update(this->background.front());
+			this->background.pop_front();
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	this->progress(this->done.size(), this->total);
+
+	if (this->visible.empty() && this->background.empty())
+	{
+		this->finish();
+	}
+}
+
+void scan_scheduler::update(const std::string &name)
+{
+	if (this->done.count(name))
+	{
+		return;
+	}
+
+	//rows removed or renamed during the pass are skipped
+	for (const std::pair<std::shared_ptr<signature_item>, const signature_item *> &p : this->order({name}))
+	{
+		if (this->done.insert(p.first->name).second)
+		{
+			p.first->update_data(*this->context, p.second);
+		}
+	}
+
+	this->done.insert(name);
+}
+
+void scan_scheduler::finish()
+{
+	this->context->save();
+	this->stop();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "signature_item.hpp"
+#include "scan_context.hpp"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class QTimer;
+
+//resolves rows a slice at a time on the ui thread, rows on screen first
+class scan_scheduler
+{
+public:
+	//rows and their ancestors, parents first, paired with the parent to scope them with
+	typedef std::function<std::vector<std::pair<std::shared_ptr<signature_item>, const signature_item *>>(const std::vector<std::string> &)> order_function_t;
+	typedef std::function<void(size_t, size_t)> progress_function_t;
+
+	scan_scheduler(const order_function_t &order, const progress_function_t &progress);
+	~scan_scheduler();
+
+	//a running pass is dropped, the page hashes are saved once every row is resolved
+	void start(const std::shared_ptr<scan_context> &context, const std::vector<std::string> &names);
+	void stop();
+	bool is_running() const;
+
+	//rows on screen, replaces the previous set
+	void prioritize(const std::vector<std::string> &names);
+
+	//for exports and saves that need the data now
+	void resolve(const std::vector<std::string> &names);
+
+private:
+	void step();
+	void update(const std::string &name);
+	void finish();
+
+	order_function_t order;
+	progress_function_t progress;
+
+	std::shared_ptr<scan_context> context;
+	std::unique_ptr<QTimer> timer;
+
+	std::vector<std::string> visible;
+	std::deque<std::string> background;
+	std::unordered_set<std::string> done;
+	size_t total;
+};
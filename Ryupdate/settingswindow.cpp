@@ -79,7 +79,9 @@ settingswindow::settingswindow(QWidget *parent)
 	std::vector<treeviewitem_t> treeview_items;
 
 	treeview_items.push_back(treeviewitem_t("General",
-										   {{"random string when inserting new signature", item_value_t([this](bool b) { newsignature_randomstring = b; }, {})}}));
+										   {{"random string when inserting new signature", item_value_t([this](bool b) { newsignature_randomstring = b; }, {})},
+											{"journaled save (append changed rows, compact in background)", item_value_t([this](bool b) { journaled_save = b; }, {})},
+											{"lazy update (visible rows first, the rest in background)", item_value_t([this](bool b) { lazy_update = b; }, {})}}));
 
 	std::unordered_map<std::string, item_value_t> item_values;
 	for (const std::pair<std::string, bool> &p : region_selection)
@@ -115,6 +117,8 @@ settingswindow::settingswindow(QWidget *parent)
 	this->insert(treeview_items);
 
 	this->newsignature_randomstring = 0;
+	this->journaled_save = 0;
+	this->lazy_update = 0;
 }
 
 settingswindow::~settingswindow()
@@ -286,6 +290,16 @@ bool settingswindow::get_newsignature_randomstring()
 	return newsignature_randomstring;
 }
 
+bool settingswindow::get_journaled_save()
+{
+	return journaled_save;
+}
+
+bool settingswindow::get_lazy_update()
+{
+	return lazy_update;
+}
+
 std::vector<std::pair<address_t, size_t>> settingswindow::get_selected_regions()
 {
 	std::vector<std::pair<address_t, size_t>> whitelisted_regions;
@@ -46,8 +46,12 @@ private:
 
 private:
 	bool newsignature_randomstring;
+	bool journaled_save;
+	bool lazy_update;
 
 public:
 	bool get_newsignature_randomstring();
+	bool get_journaled_save();
+	bool get_lazy_update();
 	std::vector<std::pair<address_t, size_t>> get_selected_regions();
 };
@@ -0,0 +1,405 @@
+#include "signature_blob.hpp"
+#include "signature_export.hpp"
+#include "code_generator.hpp"
+#include "perfect_hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <windows.h>
+#include <shlwapi.h>
+
+signature_blob::signature_blob(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures)
+{
+	std::vector<std::pair<std::string, std::shared_ptr<signature_item>>> items(signatures.begin(), signatures.end());
+	std::sort(items.begin(), items.end(), [](const std::pair<std::string, std::shared_ptr<signature_item>> &a, const std::pair<std::string, std::shared_ptr<signature_item>> &b) {
+		uint32_t ha = perfect_hash::hash(0, a.first.c_str(), a.first.size());
+		uint32_t hb = perfect_hash::hash(0, b.first.c_str(), b.first.size());
+		return ha != hb ? ha < hb : a.first < b.first;
+	});
+
+	std::vector<blob_entry> entries;
+	std::string strings;
+
+	entries.reserve(items.size());
+
+	for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : items)
+	{
+		blob_entry entry = {0};
+		entry.name_hash = perfect_hash::hash(0, p.first.c_str(), p.first.size());
+		entry.name_offset = static_cast<uint32_t>(strings.size());
+		strings.append(p.first.c_str(), p.first.size() + 1);
+
+		const std::string &n = p.second->data;
+		size_t x = 0;
+		for (x = 0; x < n.size() && isxdigit(n.at(x)); ++x);
+
+		if (x == n.size() && !n.empty())
+		{
+			entry.type = entry_address;
+			entry.value = std::stoull(n, nullptr, 16);
+		}
+		else if (n.empty() || !n.compare("ERROR"))
+		{
+			entry.type = entry_error;
+			entry.value = static_cast<unsigned long>(-1);
+		}
+		else
+		{
+			entry.type = entry_string;
+			entry.string_offset = static_cast<uint32_t>(strings.size());
+			strings.append(n.c_str(), n.size() + 1);
+		}
+
+		entries.push_back(entry);
+	}
+
+	//save moves the sequence past the blobs already written, the clock may have gone back
+	FILETIME time;
+	GetSystemTimeAsFileTime(&time);
+
+	blob_header header = {0};
+	header.magic = blob_magic;
+	header.version = blob_version;
+	header.sequence = (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	header.count = static_cast<uint32_t>(entries.size());
+	header.entry_offset = sizeof(blob_header);
+	header.string_offset = static_cast<uint32_t>(sizeof(blob_header) + entries.size() * sizeof(blob_entry));
+	header.string_size = static_cast<uint32_t>(strings.size());
+
+	data.reserve(header.string_offset + strings.size());
+	data.append(reinterpret_cast<const char *>(&header), sizeof(header));
+	if (!entries.empty())
+	{
+		data.append(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(blob_entry));
+	}
+	data.append(strings);
+}
+
+signature_blob::~signature_blob()
+{
+}
+
+bool signature_blob::save(const std::string &path)
+{
+	blob_header header;
+	memcpy(&header, data.data(), sizeof(header));
+
+	std::unique_ptr<char[]> directory = std::make_unique<char[]>(MAX_PATH);
+	std::unique_ptr<char[]> file_stem = std::make_unique<char[]>(MAX_PATH);
+
+	strcpy_s(directory.get(), MAX_PATH, path.c_str());
+	PathRemoveFileSpecA(directory.get());
+
+	strcpy_s(file_stem.get(), MAX_PATH, PathFindFileNameA(path.c_str()));
+	PathRemoveExtensionA(file_stem.get());
+
+	//stem.<sequence>.ryb, 0 for other names
+	std::string prefix = std::string(file_stem.get()) + ".";
+	auto get_sequence = [&prefix](const std::string &file) -> uint64_t {
+		if (file.size() <= prefix.size() + 4 || file.compare(0, prefix.size(), prefix) || file.compare(file.size() - 4, 4, ".ryb"))
+		{
+			return 0;
+		}
+
+		return std::strtoull(file.substr(prefix.size(), file.size() - prefix.size() - 4).c_str(), nullptr, 16);
+	};
+
+	//the pointed blob and those pending deletion
+	uint64_t previous = 0;
+
+	std::ifstream pointer(path, std::ios::binary);
+	std::string pointed;
+	if (std::getline(pointer, pointed))
+	{
+		previous = get_sequence(pointed);
+	}
+
+	std::unique_ptr<char[]> search_path = std::make_unique<char[]>(MAX_PATH);
+	PathCombineA(search_path.get(), directory.get(), (prefix + "*.ryb").c_str());
+
+	WIN32_FIND_DATAA find_data;
+	HANDLE find = FindFirstFileA(search_path.get(), &find_data);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			previous = std::max(previous, get_sequence(find_data.cFileName));
+		} while (FindNextFileA(find, &find_data));
+
+		FindClose(find);
+	}
+
+	if (header.sequence <= previous)
+	{
+		header.sequence = previous + 1;
+		memcpy(&data[0], &header, sizeof(header));
+	}
+
+	std::string blob_file = std::string(file_stem.get()) + "." + signature_item::uint_to_string<uint64_t>(header.sequence) + ".ryb";
+
+	std::unique_ptr<char[]> blob_path = std::make_unique<char[]>(MAX_PATH);
+	PathCombineA(blob_path.get(), directory.get(), blob_file.c_str());
+
+	//the blob must be complete before the pointer file names it
+	if (!signature_export::save(blob_path.get(), data) || !signature_export::save(path, blob_file))
+	{
+		return false;
+	}
+
+	//consumers map with FILE_SHARE_DELETE, a mapped blob is deleted once they close it
+	find = FindFirstFileA(search_path.get(), &find_data);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if (blob_file.compare(find_data.cFileName))
+			{
+				std::unique_ptr<char[]> old_path = std::make_unique<char[]>(MAX_PATH);
+				PathCombineA(old_path.get(), directory.get(), find_data.cFileName);
+				DeleteFileA(old_path.get());
+			}
+		} while (FindNextFileA(find, &find_data));
+
+		FindClose(find);
+	}
+
+	return true;
+}
+
+const std::string &signature_blob::get_data() const
+{
+	return data;
+}
+
+std::pair<std::string, std::string> signature_blob::make_loader(const std::string &class_name)
+{
+	std::string loader_name = class_name;
+	if (loader_name.empty())
+	{
+		loader_name = "addresses_loader";
+	}
+
+	code_generator generator(loader_name);
+
+	implementation open_impl;
+	open_impl.write("\tthis->path = path;\n\treturn this->reload();");
+
+	function open(function::access_specifier::public_access, std::make_pair<std::string, std::string>("open", "bool"));
+	open.insert_parameter(std::make_pair<std::string, std::string>("path", "const std::string &"));
+	open.set_implementation(open_impl);
+	generator.insert_function(std::move(open));
+
+	implementation reload_impl;
+	reload_impl.write(R"(	std::string blob_file;
+
+	FILE *file = fopen(this->path.c_str(), "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	char buffer[MAX_PATH];
+	size_t size = fread(buffer, 1, sizeof(buffer) - 1, file);
+	fclose(file);
+
+	blob_file.assign(buffer, size);
+
+	std::shared_ptr<const blob_mapping> current = std::atomic_load(&this->current);
+	if (current && current->file_name == blob_file)
+	{
+		return false;
+	}
+
+	std::string directory = this->path.substr(0, this->path.find_last_of("\\/") + 1);
+	std::shared_ptr<const blob_mapping> next = blob_mapping::open(directory + blob_file, blob_file);
+	if (!next)
+	{
+		return false;
+	}
+
+	//readers holding the previous snapshot keep it mapped until they are done
+	std::atomic_store(&this->current, next);
+	return true;)");
+
+	function reload(function::access_specifier::public_access, std::make_pair<std::string, std::string>("reload", "bool"));
+	reload.set_implementation(reload_impl);
+	generator.insert_function(std::move(reload));
+
+	implementation get_impl;
+	get_impl.write(R"(	std::shared_ptr<const blob_mapping> current = std::atomic_load(&this->current);
+	const blob_entry *entry = current ? current->find(name) : nullptr;
+
+	return entry && entry->type == 0 ? static_cast<unsigned long>(entry->value) : SIGNATURE_ERROR;)");
+
+	function get(function::access_specifier::public_access, std::make_pair<std::string, std::string>("get", "unsigned long"));
+	get.insert_parameter(std::make_pair<std::string, std::string>("name", "const char *"));
+	get.set_implementation(get_impl);
+	generator.insert_function(std::move(get));
+
+	implementation get_string_impl;
+	get_string_impl.write(R"(	std::shared_ptr<const blob_mapping> current = std::atomic_load(&this->current);
+	const blob_entry *entry = current ? current->find(name) : nullptr;
+
+	return entry && entry->type == 1 ? std::string(current->strings + entry->string_offset) : std::string();)");
+
+	function get_string(function::access_specifier::public_access, std::make_pair<std::string, std::string>("get_string", "std::string"));
+	get_string.insert_parameter(std::make_pair<std::string, std::string>("name", "const char *"));
+	get_string.set_implementation(get_string_impl);
+	generator.insert_function(std::move(get_string));
+
+	implementation sequence_impl;
+	sequence_impl.write(R"(	std::shared_ptr<const blob_mapping> current = std::atomic_load(&this->current);
+	return current ? current->header->sequence : 0;)");
+
+	function sequence(function::access_specifier::public_access, std::make_pair<std::string, std::string>("sequence", "uint64_t"));
+	sequence.set_implementation(sequence_impl);
+	generator.insert_function(std::move(sequence));
+
+	generator.insert_field(code_generator::access_specifier::private_access, "std::string path");
+	generator.insert_field(code_generator::access_specifier::private_access, "std::shared_ptr<const blob_mapping> current");
+
+	generator.include_header.push_back("#pragma once");
+	generator.include_header.push_back("#include <cstdint>");
+	generator.include_header.push_back("#include <memory>");
+	generator.include_header.push_back("#include <string>\n");
+	generator.include_header.push_back("struct blob_mapping;");
+
+	generator.include_source.push_back("#include \"" + loader_name + ".hpp\"\n");
+	generator.include_source.push_back("#include <windows.h>");
+	generator.include_source.push_back("#include <atomic>");
+	generator.include_source.push_back("#include <cstdio>");
+	generator.include_source.push_back("#include <cstring>");
+	generator.include_source.push_back("\n#define SIGNATURE_ERROR static_cast<unsigned long>(-1)\n");
+	generator.include_source.push_back(R"(#pragma pack(push, 1)
+struct blob_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sequence;
+	uint32_t count;
+	uint32_t entry_offset;
+	uint32_t string_offset;
+	uint32_t string_size;
+};
+
+struct blob_entry
+{
+	uint32_t name_hash;
+	uint32_t name_offset;
+	uint32_t type;
+	uint32_t string_offset;
+	uint64_t value;
+};
+#pragma pack(pop)
+
+struct blob_mapping
+{
+	std::string file_name;
+	HANDLE file;
+	HANDLE section;
+	const uint8_t *view;
+
+	const blob_header *header;
+	const blob_entry *entries;
+	const char *strings;
+
+	~blob_mapping()
+	{
+		if (view)
+		{
+			UnmapViewOfFile(view);
+		}
+
+		if (section)
+		{
+			CloseHandle(section);
+		}
+
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file);
+		}
+	}
+
+	static std::shared_ptr<const blob_mapping> open(const std::string &path, const std::string &file_name)
+	{
+		std::shared_ptr<blob_mapping> mapping = std::make_shared<blob_mapping>();
+		mapping->file_name = file_name;
+		mapping->section = nullptr;
+		mapping->view = nullptr;
+
+		mapping->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (mapping->file == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(mapping->file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(blob_header)))
+		{
+			return nullptr;
+		}
+
+		mapping->section = CreateFileMappingA(mapping->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		mapping->view = mapping->section ? static_cast<const uint8_t *>(MapViewOfFile(mapping->section, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		if (mapping->view == nullptr)
+		{
+			return nullptr;
+		}
+
+		mapping->header = reinterpret_cast<const blob_header *>(mapping->view);
+		if (mapping->header->magic != 0x42555952 || mapping->header->version != 1 ||
+			mapping->header->entry_offset + static_cast<uint64_t>(mapping->header->count) * sizeof(blob_entry) > mapping->header->string_offset ||
+			mapping->header->string_offset + static_cast<uint64_t>(mapping->header->string_size) > static_cast<uint64_t>(size.QuadPart))
+		{
+			return nullptr;
+		}
+
+		mapping->entries = reinterpret_cast<const blob_entry *>(mapping->view + mapping->header->entry_offset);
+		mapping->strings = reinterpret_cast<const char *>(mapping->view + mapping->header->string_offset);
+
+		return mapping;
+	}
+
+	const blob_entry *find(const char *name) const
+	{
+		size_t length = strlen(name);
+
+		uint32_t hash = 0x811C9DC5;
+		for (size_t n = 0; n < length; ++n)
+		{
+			hash = (hash ^ static_cast<uint8_t>(name[n])) * 0x01000193;
+		}
+
+		//entries are sorted by name hash
+		size_t first = 0, last = header->count;
+		while (first < last)
+		{
+			size_t middle = first + (last - first) / 2;
+			if (entries[middle].name_hash < hash)
+			{
+				first = middle + 1;
+			}
+			else
+			{
+				last = middle;
+			}
+		}
+
+		for (; first < header->count && entries[first].name_hash == hash; ++first)
+		{
+			if (!strcmp(strings + entries[first].name_offset, name))
+			{
+				return entries + first;
+			}
+		}
+
+		return nullptr;
+	}
+};)");
+
+	return std::make_pair(generator.get_header(), generator.get_source());
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "signature_item.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+//versioned, memory-mappable result blob
+//
+//	header	blob_header
+//	entries	blob_entry[count], sorted by name_hash
+//	strings	nul terminated names and string values
+//
+//saves write stem.<sequence>.ryb, then rename a pointer file naming it over the old one
+class signature_blob
+{
+public:
+	enum : uint32_t
+	{
+		blob_magic = 0x42555952, //RYUB
+		blob_version = 1
+	};
+
+	enum entry_type : uint32_t
+	{
+		entry_address = 0,
+		entry_string,
+		entry_error
+	};
+
+#pragma pack(push, 1)
+	struct blob_header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sequence;
+		uint32_t count;
+		uint32_t entry_offset;
+		uint32_t string_offset;
+		uint32_t string_size;
+	};
+
+	struct blob_entry
+	{
+		uint32_t name_hash;
+		uint32_t name_offset;
+		uint32_t type;
+		uint32_t string_offset;
+		uint64_t value;
+	};
+#pragma pack(pop)
+
+	signature_blob(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures);
+	~signature_blob();
+
+	//path is the pointer file, the blob itself is written next to it
+	bool save(const std::string &path);
+
+	const std::string &get_data() const;
+
+	//loader class for consumers, returns header and source
+	static std::pair<std::string, std::string> make_loader(const std::string &class_name = "");
+
+private:
+	std::string data;
+};
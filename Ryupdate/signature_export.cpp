@@ -1,9 +1,12 @@
 #include "signature_export.hpp"
 #include "code_generator.hpp"
+#include "perfect_hash.hpp"
+#include "pattern.hpp"
+#include "pattern_set.hpp"
+#include "file_sink.hpp"
 #include <fstream>
 #include <sstream>
 #include <unordered_map>
-#include <unordered_set>
 #include <algorithm>
 
 signature_export::signature_export(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &class_name)
@@ -14,9 +17,10 @@ signature_export::signature_export(const std::unordered_map<std::string, std::sh
 		this->class_name = "addresses";
 	}
 
-	std::unordered_map<std::string, address_t> addresses;
-	std::unordered_set<std::string> errors;
-	std::unordered_map<std::string, std::string> tag;
+	//ordered so that the output is identical between runs
+	std::map<std::string, address_t> addresses;
+	std::set<std::string> errors;
+	std::map<std::string, std::string> tag;
 
 	for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
 	{
@@ -24,11 +28,11 @@ signature_export::signature_export(const std::unordered_map<std::string, std::sh
 		size_t x = 0;
 		for (x = 0; x < n.size() && isxdigit(n.at(x)); ++x);
 
-		if (x == n.size())
+		if (x == n.size() && !n.empty())
 		{
 			addresses[p.first] = std::stoull(n, nullptr, 16);
 		}
-		else if (!n.compare("ERROR"))
+		else if (!n.compare("ERROR") || n.empty())
 		{
 			errors.insert(p.first);
 		}
@@ -38,7 +42,8 @@ signature_export::signature_export(const std::unordered_map<std::string, std::sh
 		}
 	}
 
-	code_generator generator(this->class_name);
+	this->generator = std::make_unique<code_generator>(this->class_name);
+	code_generator &generator = *this->generator;
 	implementation constructor;
 
 	for (const std::pair<std::string, address_t> &p : addresses)
@@ -56,7 +61,7 @@ signature_export::signature_export(const std::unordered_map<std::string, std::sh
 		function func(function::access_specifier::public_access, std::make_pair<std::string, std::string>("get_" + p.first, "unsigned long"));
 		func.set_implementation(impl);
 
-		generator.insert_function(func);
+		generator.insert_function(std::move(func));
 	}
 
 	for (const std::pair<std::string, std::string> &p : tag)
@@ -74,7 +79,7 @@ signature_export::signature_export(const std::unordered_map<std::string, std::sh
 		function func(function::access_specifier::public_access, std::make_pair<std::string, std::string>("get_" + p.first, "std::string"));
 		func.set_implementation(impl);
 
-		generator.insert_function(func);
+		generator.insert_function(std::move(func));
 	}
 
 	for (const std::string &p : errors)
@@ -92,7 +97,7 @@ signature_export::signature_export(const std::unordered_map<std::string, std::sh
 		function func(function::access_specifier::public_access, std::make_pair<std::string, std::string>("get_" + p, "unsigned long"));
 		func.set_implementation(impl);
 
-		generator.insert_function(func);
+		generator.insert_function(std::move(func));
 	}
 
 	generator.set_constructor(constructor);
@@ -101,9 +106,6 @@ signature_export::signature_export(const std::unordered_map<std::string, std::sh
 	generator.include_header.push_back("#include <string>");
 	generator.include_source.push_back("#include \"" + this->class_name + ".hpp\"");
 	generator.include_source.push_back("\n#define SIGNATURE_ERROR static_cast<unsigned long>(-1)");
-
-	this->header = generator.get_header();
-	this->source = generator.get_source();
 }
 
 signature_export::~signature_export()
@@ -112,29 +114,109 @@ signature_export::~signature_export()
 
 bool signature_export::save_source(const std::string &path)
 {
-	return signature_export::save(path, this->source);
+	return signature_export::save(path, [this](std::ostream &os) {
+		this->generator->write_source(os);
+	});
 }
 
 bool signature_export::save_header(const std::string &path)
 {
-	return signature_export::save(path, this->header);
+	return signature_export::save(path, [this](std::ostream &os) {
+		this->generator->write_header(os);
+	});
 }
 
-bool signature_export::save(const std::string &file, const std::string &data)
+bool signature_export::save(const std::string &file, const std::string &data, bool *written)
 {
-	std::ofstream fs(file);
-	if (fs.is_open())
-	{
-		fs << data;
-		fs.close();
+	return signature_export::save(file, [&data](std::ostream &os) {
+		os.write(data.data(), data.size());
+	}, written);
+}
+
+bool signature_export::save(const std::string &file, const std::function<void(std::ostream &)> &writer, bool *written)
+{
+	//an unchanged file keeps its timestamp, dependents are not rebuilt
+	file_sink sink(file);
+	std::ostream os(&sink);
+
+	writer(os);
+	os.flush();
+
+	bool result = sink.close() && os.good();
 
-		return true;
+	if (written)
+	{
+		*written = result && sink.changed();
 	}
 
-	return false;
+	return result;
 }
 
 std::string signature_export::make_header(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &prefix)
+{
+	std::stringstream ss;
+	write_header(ss, signatures, prefix);
+	return ss.str();
+}
+
+void signature_export::write_header(std::ostream &os, const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &prefix)
+{
+	std::set<std::string> defined_names;
+	os << "#define SIGNATURE_ERROR -1\n\n";
+
+	write_defines(os, sort(signatures), prefix, defined_names);
+}
+
+std::map<std::string, std::string> signature_export::make_sharded_header(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &prefix, const std::string &file_stem)
+{
+	std::map<std::string, std::vector<const signature_entry *>> groups;
+	for (const signature_entry *p : sort(signatures))
+	{
+		groups[get_group(p->first)].push_back(p);
+	}
+
+	std::map<std::string, std::string> files;
+	std::set<std::string> defined_names;
+	std::stringstream umbrella;
+	umbrella << "#pragma once\n\n";
+
+	for (const std::pair<std::string, std::vector<const signature_entry *>> &group : groups)
+	{
+		std::string file_name = file_stem + "_" + group.first + ".h";
+
+		std::stringstream ss;
+		ss << "#pragma once\n\n";
+		ss << "#define SIGNATURE_ERROR -1\n\n";
+
+		write_defines(ss, group.second, prefix, defined_names);
+
+		files[file_name] = ss.str();
+		umbrella << "#include \"" << file_name << "\"\n";
+	}
+
+	files[file_stem + ".h"] = umbrella.str();
+
+	return files;
+}
+
+std::vector<const signature_export::signature_entry *> signature_export::sort(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures)
+{
+	std::vector<const signature_entry *> entries;
+	entries.reserve(signatures.size());
+
+	for (const signature_entry &p : signatures)
+	{
+		entries.push_back(&p);
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const signature_entry *a, const signature_entry *b) {
+		return a->first < b->first;
+	});
+
+	return entries;
+}
+
+void signature_export::write_defines(std::ostream &os, const std::vector<const signature_entry *> &signatures, const std::string &prefix, std::set<std::string> &defined_names)
 {
 	std::string signature_prefix = prefix;
 	if (!signature_prefix.empty())
@@ -145,40 +227,104 @@ std::string signature_export::make_header(const std::unordered_map<std::string,
 		}
 	}
 
-	std::unordered_set<std::string> defined_names;
-	std::stringstream ss;
-	ss << "#define SIGNATURE_ERROR -1\n\n";
-	for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+	char hex[sizeof(address_t) * 2];
+	std::string define_name;
+
+	for (const signature_entry *p : signatures)
 	{
-		ss << "//" << p.second->signature << " [Result: " << std::to_string(p.second->result) << ']';
-		std::string comment = p.second->comments;
-		if (!comment.empty())
+		const signature_item &item = *p->second;
+
+		os << "//" << item.signature << " [Result: " << item.result << ']';
+		if (!item.comments.empty())
 		{
-			ss << " {" << comment << '}';
+			os << " {" << item.comments << '}';
 		}
-		ss << '\n';
+		os << '\n';
 
-		std::string define_name = signature_prefix + p.first;
+		define_name = signature_prefix;
+		define_name += p->first;
 		std::transform(define_name.begin(), define_name.end(), define_name.begin(), ::toupper);
 
-		if (!defined_names.count(define_name))
+		//while set contains define_name
+		while (defined_names.count(define_name))
 		{
-			defined_names.insert(define_name);
+			define_name.insert(define_name.begin(), '_');
+		}
+
+		defined_names.insert(define_name);
+
+		os << "#define " << define_name;
+
+		if (!item.data.compare("ERROR"))
+		{
+			os << " SIGNATURE_ERROR";
 		}
 		else
 		{
-			//while set contains define_name
-			while (defined_names.count(define_name))
+			const std::string &n = item.data;
+			size_t x = 0;
+			for (x = 0; x < n.size() && isxdigit(n.at(x)); ++x);
+
+			if (x == n.size() && !n.empty())
+			{
+				//address
+				signature_item::uint_to_chars<address_t>(hex, static_cast<address_t>(std::stoull(n, nullptr, 16)));
+				os << " 0x";
+				os.write(hex, sizeof(hex));
+			}
+			else
 			{
-				define_name = "_" + define_name;
+				//string
+				os << " \"" << n << '"';
 			}
+		}
+
+		os << "\n\n";
+	}
+}
+
+std::string signature_export::get_group(const std::string &name)
+{
+	size_t x = name.find('_');
+	if (x == std::string::npos || x == 0)
+	{
+		return "general";
+	}
+
+	std::string group = name.substr(0, x);
+	std::transform(group.begin(), group.end(), group.begin(), ::tolower);
+
+	return group;
+}
+
+std::string signature_export::make_constexpr_header(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &name_space)
+{
+	std::string signature_namespace = name_space;
+	if (signature_namespace.empty())
+	{
+		signature_namespace = "addresses";
+	}
+
+	std::stringstream ss;
+	ss << "#pragma once\n\n";
+	ss << "namespace " << signature_namespace << "\n{\n";
+	ss << "\tinline constexpr unsigned long signature_error = static_cast<unsigned long>(-1);\n\n";
+
+	for (const signature_entry *entry : sort(signatures))
+	{
+		const signature_entry &p = *entry;
 
-			defined_names.insert(define_name);
+		ss << "\t//" << p.second->signature << " [Result: " << std::to_string(p.second->result) << ']';
+		std::string comment = p.second->comments;
+		if (!comment.empty())
+		{
+			ss << " {" << comment << '}';
 		}
+		ss << '\n';
 
 		if (!p.second->data.compare("ERROR"))
 		{
-			ss << "#define " << define_name << " SIGNATURE_ERROR";
+			ss << "\tinline constexpr unsigned long " << p.first << " = signature_error;";
 		}
 		else
 		{
@@ -186,24 +332,568 @@ std::string signature_export::make_header(const std::unordered_map<std::string,
 			size_t x = 0;
 			for (x = 0; x < n.size() && isxdigit(n.at(x)); ++x);
 
-			if (x == n.size())
+			if (x == n.size() && !n.empty())
 			{
 				//address
-				ss << "#define " << define_name << " 0x" << signature_item::uint_to_string<address_t>(std::stoull(p.second->data, nullptr, 16));
+				ss << "\tinline constexpr unsigned long " << p.first << " = 0x" << signature_item::uint_to_string<address_t>(std::stoull(n, nullptr, 16)) << ';';
 			}
 			else
 			{
 				//string
-				ss << "#define " << define_name << " \"" << p.second->data << "\"";
+				ss << "\tinline constexpr const char " << p.first << "[] = \"" << n << "\";";
 			}
 		}
 
 		ss << "\n\n";
 	}
 
+	ss << "}\n";
+
 	return ss.str();
 }
 
+std::pair<std::string, std::string> signature_export::make_table(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &class_name)
+{
+	std::string table_name = class_name;
+	if (table_name.empty())
+	{
+		table_name = "addresses";
+	}
+
+	std::string id_name = table_name + "_id";
+
+	std::vector<std::string> names;
+	names.reserve(signatures.size());
+	for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+	{
+		names.push_back(p.first);
+	}
+	std::sort(names.begin(), names.end());
+
+	//enum values follow the hash slots so that a lookup yields the index directly
+	perfect_hash hash(names);
+	const std::vector<std::string> &slots = hash.get_slots();
+
+	//the sentinel must not take the name of a row, rows are free to be called signature_count as well
+	std::string count_name = "signature_count";
+	while (std::binary_search(names.begin(), names.end(), count_name))
+	{
+		count_name += '_';
+	}
+
+	std::string count = id_name + "::" + count_name;
+
+	std::stringstream enumeration;
+	enumeration << "enum class " << id_name << " : uint32_t\n{\n";
+	for (size_t n = 0; n < slots.size(); ++n)
+	{
+		enumeration << '\t' << slots.at(n) << " = " << n << ",\n";
+	}
+	enumeration << '\t' << count_name << " = " << slots.size() << "\n};";
+
+	std::stringstream value, text, name, length, displacement;
+	for (size_t n = 0; n < slots.size(); ++n)
+	{
+		const std::shared_ptr<signature_item> &item = signatures.at(slots.at(n));
+
+		std::string data = item->data;
+		size_t x = 0;
+		for (x = 0; x < data.size() && isxdigit(data.at(x)); ++x);
+
+		value << "\t//" << item->signature << " [Result: " << std::to_string(item->result) << ']';
+		if (!item->comments.empty())
+		{
+			value << " {" << item->comments << '}';
+		}
+		value << '\n';
+
+		if (x == data.size() && !data.empty())
+		{
+			value << "\t0x" << signature_item::uint_to_string<address_t>(std::stoull(data, nullptr, 16)) << ",\n";
+			text << "\tnullptr,\n";
+		}
+		else
+		{
+			value << "\tSIGNATURE_ERROR,\n";
+			text << (data.empty() || !data.compare("ERROR") ? "\tnullptr,\n" : "\t\"" + data + "\",\n");
+		}
+
+		name << "\t\"" << slots.at(n) << "\",\n";
+		length << '\t' << slots.at(n).size() << ",\n";
+		displacement << '\t' << hash.get_displacement().at(n) << ",\n";
+	}
+
+	if (slots.empty())
+	{
+		//arrays cannot be empty, lookups are rejected by the count check
+		value << "\tSIGNATURE_ERROR,\n";
+		text << "\tnullptr,\n";
+		name << "\t\"\",\n";
+		length << "\t0,\n";
+		displacement << "\t0,\n";
+	}
+
+	code_generator generator(table_name);
+
+	implementation find_impl;
+	find_impl.write_line("\tconst size_t size = static_cast<size_t>(" + count + ");");
+	find_impl.write_line("\tif (size == 0)\n\t{\n\t\treturn " + count + ";\n\t}\n");
+	find_impl.write_line("\tint32_t d = table_displacement[table_hash(0, name, length) % size];");
+	find_impl.write_line("\tsize_t index = d < 0 ? static_cast<size_t>(-d - 1) : table_hash(static_cast<uint32_t>(d), name, length) % size;\n");
+	find_impl.write_line("\tif (table_name_length[index] != length || std::memcmp(table_name[index], name, length))\n\t{\n\t\treturn " + count + ";\n\t}\n");
+	find_impl.write("\treturn static_cast<" + id_name + ">(index);");
+
+	function find(function::access_specifier::public_access, std::make_pair<std::string, std::string>("find", std::string(id_name)));
+	find.insert_parameter(std::make_pair<std::string, std::string>("name", "const char *"));
+	find.insert_parameter(std::make_pair<std::string, std::string>("length", "size_t"));
+	find.set_static(true);
+	find.set_implementation(find_impl);
+	generator.insert_function(find);
+
+	implementation get_impl;
+	get_impl.write("\treturn id < " + count + " ? table_value[static_cast<size_t>(id)] : SIGNATURE_ERROR;");
+
+	function get(function::access_specifier::public_access, std::make_pair<std::string, std::string>("get", "unsigned long"));
+	get.insert_parameter(std::make_pair<std::string, std::string>("id", std::string(id_name)));
+	get.set_static(true);
+	get.set_implementation(get_impl);
+	generator.insert_function(get);
+
+	implementation get_string_impl;
+	get_string_impl.write("\treturn id < " + count + " ? table_string[static_cast<size_t>(id)] : nullptr;");
+
+	function get_string(function::access_specifier::public_access, std::make_pair<std::string, std::string>("get_string", "const char *"));
+	get_string.insert_parameter(std::make_pair<std::string, std::string>("id", std::string(id_name)));
+	get_string.set_static(true);
+	get_string.set_implementation(get_string_impl);
+	generator.insert_function(get_string);
+
+	implementation get_name_impl;
+	get_name_impl.write("\treturn id < " + count + " ? table_name[static_cast<size_t>(id)] : nullptr;");
+
+	function get_name(function::access_specifier::public_access, std::make_pair<std::string, std::string>("get_name", "const char *"));
+	get_name.insert_parameter(std::make_pair<std::string, std::string>("id", std::string(id_name)));
+	get_name.set_static(true);
+	get_name.set_implementation(get_name_impl);
+	generator.insert_function(get_name);
+
+	generator.include_header.push_back("#pragma once");
+	generator.include_header.push_back("#include <cstddef>");
+	generator.include_header.push_back("#include <cstdint>\n");
+	generator.include_header.push_back(enumeration.str());
+
+	generator.include_source.push_back("#include \"" + table_name + ".hpp\"");
+	generator.include_source.push_back("#include <cstring>");
+	generator.include_source.push_back("\n#define SIGNATURE_ERROR static_cast<unsigned long>(-1)\n");
+	generator.include_source.push_back("static const unsigned long table_value[] =\n{\n" + value.str() + "};\n");
+	generator.include_source.push_back("static const char *const table_string[] =\n{\n" + text.str() + "};\n");
+	generator.include_source.push_back("static const char *const table_name[] =\n{\n" + name.str() + "};\n");
+	generator.include_source.push_back("static const size_t table_name_length[] =\n{\n" + length.str() + "};\n");
+	generator.include_source.push_back("static const int32_t table_displacement[] =\n{\n" + displacement.str() + "};\n");
+	generator.include_source.push_back(
+		"static uint32_t table_hash(uint32_t seed, const char *key, size_t length)\n{\n"
+		"\tuint32_t h = seed ? seed : 0x811C9DC5;\n"
+		"\tfor (size_t n = 0; n < length; ++n)\n\t{\n"
+		"\t\th = (h ^ static_cast<uint8_t>(key[n])) * 0x01000193;\n\t}\n\n"
+		"\treturn h;\n}");
+
+	return std::make_pair(generator.get_header(), generator.get_source());
+}
+
+std::pair<std::string, std::string> signature_export::make_resolver(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &class_name, const std::string &module_name, std::vector<std::string> *baked_names)
+{
+	std::string resolver_name = class_name;
+	if (resolver_name.empty())
+	{
+		resolver_name = "addresses";
+	}
+
+	std::vector<std::string> names;
+	names.reserve(signatures.size());
+	for (const std::pair<std::string, std::shared_ptr<signature_item>> &p : signatures)
+	{
+		names.push_back(p.first);
+	}
+	std::sort(names.begin(), names.end());
+
+	code_generator generator(resolver_name);
+
+	std::stringstream table, data;
+	uint32_t signature_hash = 0x811C9DC5;
+
+	for (size_t n = 0; n < names.size(); ++n)
+	{
+		const std::shared_ptr<signature_item> &item = signatures.at(names.at(n));
+
+		std::string value = item->data;
+		size_t x = 0;
+		for (x = 0; x < value.size() && isxdigit(value.at(x)); ++x);
+
+		bool is_number = x == value.size() && !value.empty();
+		std::string baked = is_number ? "0x" + signature_item::uint_to_string<address_t>(std::stoull(value, nullptr, 16)) : "SIGNATURE_ERROR";
+
+		//0 address, 1 operand field, 2 baked value (not resolvable at runtime)
+		uint32_t type = 2;
+		signature_item::operand_encoding encoding = {0, 0, 0, false};
+		std::unique_ptr<pattern> compiled;
+
+		try
+		{
+			compiled = std::make_unique<pattern>(item->signature);
+		}
+		catch (std::exception &)
+		{
+		}
+
+		//the generated scanner only compares value and mask, other rows keep the value found now
+		if (!item->parent.empty() || item->xref != signature_item::xref_none || !item->symbol.empty() || !item->stages.empty() || item->aligned || item->function_start || item->relocatable || (compiled && compiled->is_extended()))
+		{
+			compiled.reset();
+		}
+
+		if (compiled && item->type == signature_item::type_address)
+		{
+			//a selected instruction keeps the distance from the hit it had when the row was scanned
+			if (item->instruction_index == 0 && item->byte_offset >= 0)
+			{
+				type = 0;
+				encoding.offset = static_cast<size_t>(item->byte_offset);
+			}
+			else if (item->address != 0 && item->instruction_address >= item->address)
+			{
+				type = 0;
+				encoding.offset = item->instruction_address - item->address;
+			}
+		}
+		else if (compiled && item->get_operand_encoding(encoding))
+		{
+			type = 1;
+		}
+
+		if (type == 2 && is_number && baked_names != nullptr)
+		{
+			baked_names->push_back(names.at(n));
+		}
+
+		table << "\t//" << item->signature << " [Result: " << std::to_string(item->result) << ']';
+		if (!item->comments.empty())
+		{
+			table << " {" << item->comments << '}';
+		}
+		table << "\n\t{ \"" << names.at(n) << "\", ";
+
+		if (type != 2)
+		{
+			data << "static const uint8_t pattern_" << n << "[] = { ";
+			for (uint8_t b : compiled->get_bytes())
+			{
+				data << "0x" << signature_item::uint_to_string<uint8_t>(b) << ", ";
+			}
+			data << "};\nstatic const uint8_t mask_" << n << "[] = { ";
+			for (uint8_t b : compiled->get_mask())
+			{
+				data << "0x" << signature_item::uint_to_string<uint8_t>(b) << ", ";
+			}
+			data << "};\n";
+
+			table << "pattern_" << n << ", mask_" << n << ", " << compiled->size() << ", ";
+
+			std::string normalized = compiled->get_pattern();
+			signature_hash = perfect_hash::hash(signature_hash, normalized.c_str(), normalized.size());
+		}
+		else
+		{
+			table << "nullptr, nullptr, 0, ";
+		}
+
+		//keyed like in pattern_set
+		size_t key_offset = type != 2 ? pattern_set::get_key_offset(*compiled) : pattern_set::unkeyed_offset;
+		std::string key = key_offset != pattern_set::unkeyed_offset ? std::to_string(key_offset) : "SIGNATURE_UNKEYED";
+
+		table << item->result << ", " << type << ", " << encoding.offset << ", " << encoding.size << ", " << encoding.length << ", " << (encoding.relative ? "true" : "false") << ", " << baked << ", " << key << " },\n";
+
+		signature_hash = perfect_hash::hash(signature_hash, names.at(n).c_str(), names.at(n).size());
+		signature_hash ^= static_cast<uint32_t>(item->result * 31 + type + encoding.offset * 131);
+
+		implementation impl;
+		function func(function::access_specifier::public_access, std::make_pair<std::string, std::string>("get_" + names.at(n), "unsigned long"));
+
+		if (is_number || type != 2 || !value.compare("ERROR") || value.empty())
+		{
+			impl.write("\treturn this->values[" + std::to_string(n) + "];");
+		}
+		else
+		{
+			func.get_decl().second = "std::string";
+			impl.write("\treturn \"" + value + "\";");
+		}
+
+		func.set_implementation(impl);
+		generator.insert_function(func);
+	}
+
+	if (names.empty())
+	{
+		table << "\t{ \"\", nullptr, nullptr, 0, 0, 2, 0, 0, 0, false, SIGNATURE_ERROR, SIGNATURE_UNKEYED },\n";
+	}
+
+	std::string count = std::to_string(names.empty() ? 1 : names.size());
+
+	generator.insert_field(code_generator::access_specifier::private_access, "unsigned long values[" + count + "]");
+	generator.insert_field(code_generator::access_specifier::private_access, "bool cached");
+
+	implementation is_cached_impl;
+	is_cached_impl.write("\treturn this->cached;");
+
+	function is_cached(function::access_specifier::public_access, std::make_pair<std::string, std::string>("is_cached", "bool"));
+	is_cached.set_implementation(is_cached_impl);
+	generator.insert_function(is_cached);
+
+	implementation constructor;
+	constructor.write("\tthis->cached = resolve(this->values);");
+	generator.set_constructor(constructor);
+
+	generator.include_header.push_back("#pragma once");
+	generator.include_header.push_back("#include <string>");
+
+	generator.include_source.push_back("#include \"" + resolver_name + ".hpp\"\n");
+	generator.include_source.push_back("#include <windows.h>");
+	generator.include_source.push_back("#include <cstdint>");
+	generator.include_source.push_back("#include <cstring>");
+	generator.include_source.push_back("#include <cstdio>");
+	generator.include_source.push_back("#include <vector>");
+	generator.include_source.push_back("\n#define SIGNATURE_ERROR static_cast<unsigned long>(-1)");
+	generator.include_source.push_back("#define SIGNATURE_UNKEYED static_cast<size_t>(-1)\n");
+	generator.include_source.push_back(
+		"struct signature\n{\n"
+		"\tconst char *name;\n"
+		"\tconst uint8_t *bytes;\n"
+		"\tconst uint8_t *mask;\n"
+		"\tsize_t size;\n"
+		"\tsize_t result;\n"
+		"\t//0 address (hit + field_offset), 1 operand field, 2 baked value\n"
+		"\tuint32_t type;\n"
+		"\tsize_t field_offset;\n"
+		"\tsize_t field_size;\n"
+		"\tsize_t length;\n"
+		"\tbool relative;\n"
+		"\tunsigned long baked;\n"
+		"\t//offset of the two fixed bytes the row is keyed by\n"
+		"\tsize_t key_offset;\n"
+		"};\n");
+	generator.include_source.push_back(data.str());
+	generator.include_source.push_back("static const signature signatures[] =\n{\n" + table.str() + "};\n");
+	generator.include_source.push_back("static const size_t signature_count = " + std::to_string(names.size()) + ";");
+	generator.include_source.push_back("static const uint32_t signature_hash = 0x" + signature_item::uint_to_string<uint32_t>(signature_hash) + ";");
+	generator.include_source.push_back("static const char module_name[] = \"" + module_name + "\";\n");
+	generator.include_source.push_back(R"(static bool match(const signature &s, const uint8_t *p)
+{
+	size_t n = 0;
+	for (; n < s.size && (p[n] & s.mask[n]) == s.bytes[n]; ++n);
+
+	return n == s.size;
+}
+
+//value of the row whose hit is p
+static unsigned long read(const signature &s, const uint8_t *p, const uint8_t *base, size_t size)
+{
+	if (s.type == 0)
+	{
+		return static_cast<unsigned long>(reinterpret_cast<uintptr_t>(p + s.field_offset));
+	}
+
+	if (p + s.field_offset + s.field_size > base + size)
+	{
+		return SIGNATURE_ERROR;
+	}
+
+	unsigned long field = 0;
+	memcpy(&field, p + s.field_offset, s.field_size);
+
+	if (s.relative)
+	{
+		return static_cast<unsigned long>(reinterpret_cast<uintptr_t>(p) + s.length + static_cast<int32_t>(field));
+	}
+
+	return field;
+}
+
+//rows without two neighbouring fixed bytes
+static unsigned long scan(const signature &s, const uint8_t *base, size_t size)
+{
+	size_t hits = 0;
+	for (const uint8_t *p = base, *last = base + size - s.size; p <= last; ++p)
+	{
+		if (match(s, p) && ++hits == s.result)
+		{
+			return read(s, p, base, size);
+		}
+	}
+
+	return SIGNATURE_ERROR;
+}
+
+//one pass for every keyed row, ends once every row has its hit
+static void scan_all(const uint8_t *base, size_t size, unsigned long *values)
+{
+	std::vector<uint32_t> first(0x10000 + 1, 0), items;
+	std::vector<size_t> hits(signature_count, 0);
+	size_t pending = 0;
+
+	for (size_t n = 0; n < signature_count; ++n)
+	{
+		const signature &s = signatures[n];
+		values[n] = s.baked;
+
+		if (s.type == 2 || size < s.size)
+		{
+			continue;
+		}
+
+		values[n] = SIGNATURE_ERROR;
+
+		if (s.key_offset == SIGNATURE_UNKEYED)
+		{
+			values[n] = scan(s, base, size);
+			continue;
+		}
+
+		++first[(s.bytes[s.key_offset] | (s.bytes[s.key_offset + 1] << 8)) + 1];
+		++pending;
+	}
+
+	for (size_t k = 0; k < 0x10000; ++k)
+	{
+		first[k + 1] += first[k];
+	}
+
+	items.resize(first.back());
+
+	std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+	for (size_t n = 0; n < signature_count; ++n)
+	{
+		const signature &s = signatures[n];
+		if (s.type != 2 && size >= s.size && s.key_offset != SIGNATURE_UNKEYED)
+		{
+			items[fill[s.bytes[s.key_offset] | (s.bytes[s.key_offset + 1] << 8)]++] = static_cast<uint32_t>(n);
+		}
+	}
+
+	for (const uint8_t *p = base, *end = base + size; p + 1 < end && pending != 0; ++p)
+	{
+		uint32_t key = p[0] | (p[1] << 8);
+
+		for (uint32_t i = first[key]; i != first[key + 1]; ++i)
+		{
+			const signature &s = signatures[items[i]];
+			if (hits[items[i]] == s.result || static_cast<size_t>(p - base) < s.key_offset)
+			{
+				continue;
+			}
+
+			const uint8_t *start = p - s.key_offset;
+			if (static_cast<size_t>(end - start) >= s.size && match(s, start) && ++hits[items[i]] == s.result)
+			{
+				values[items[i]] = read(s, start, base, size);
+				--pending;
+			}
+		}
+	}
+}
+
+//keyed by the pe header, the signature hash and the load base
+static bool cache_path(const uint8_t *base, char *path, size_t size)
+{
+	const IMAGE_DOS_HEADER *dos = reinterpret_cast<const IMAGE_DOS_HEADER *>(base);
+	const IMAGE_NT_HEADERS *nt = reinterpret_cast<const IMAGE_NT_HEADERS *>(base + dos->e_lfanew);
+
+	char directory[MAX_PATH];
+	if (!GetTempPathA(MAX_PATH, directory))
+	{
+		return false;
+	}
+
+	snprintf(path, size, "%s%s_%08X_%08X_%llX_%08X.cache", directory, module_name[0] ? module_name : "module",
+		static_cast<uint32_t>(nt->FileHeader.TimeDateStamp), static_cast<uint32_t>(nt->OptionalHeader.SizeOfImage),
+		static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(base)), signature_hash);
+
+	return true;
+}
+
+static bool resolve(unsigned long *values)
+{
+	const uint8_t *base = reinterpret_cast<const uint8_t *>(GetModuleHandleA(module_name[0] ? module_name : nullptr));
+	if (base == nullptr)
+	{
+		for (size_t n = 0; n < signature_count; ++n)
+		{
+			values[n] = signatures[n].baked;
+		}
+
+		return false;
+	}
+
+	const IMAGE_NT_HEADERS *nt = reinterpret_cast<const IMAGE_NT_HEADERS *>(base + reinterpret_cast<const IMAGE_DOS_HEADER *>(base)->e_lfanew);
+	size_t size = nt->OptionalHeader.SizeOfImage;
+
+	char path[MAX_PATH * 2];
+	bool has_path = cache_path(base, path, sizeof(path));
+
+	//signature hash and row count, then one value per row and nothing behind them
+	if (has_path)
+	{
+		FILE *file = fopen(path, "rb");
+		if (file != nullptr)
+		{
+			uint32_t header[2] = {0, 0};
+			bool complete = fread(header, sizeof(header), 1, file) == 1 && header[0] == signature_hash && header[1] == signature_count &&
+				fread(values, sizeof(unsigned long), signature_count, file) == signature_count && fgetc(file) == EOF;
+			fclose(file);
+
+			if (complete)
+			{
+				return true;
+			}
+		}
+	}
+
+	scan_all(base, size, values);
+
+	//a failed scan is retried on the next load
+	for (size_t n = 0; n < signature_count; ++n)
+	{
+		if (signatures[n].type != 2 && (values[n] == SIGNATURE_ERROR || (signatures[n].type == 0 && values[n] == 0)))
+		{
+			has_path = false;
+		}
+	}
+
+	//renamed over the cache, never torn
+	if (has_path)
+	{
+		char temporary_path[MAX_PATH * 2 + 16];
+		snprintf(temporary_path, sizeof(temporary_path), "%s.%lu.tmp", path, static_cast<unsigned long>(GetCurrentProcessId()));
+
+		FILE *file = fopen(temporary_path, "wb");
+		if (file != nullptr)
+		{
+			uint32_t header[2] = {signature_hash, static_cast<uint32_t>(signature_count)};
+			bool written = fwrite(header, sizeof(header), 1, file) == 1 && fwrite(values, sizeof(unsigned long), signature_count, file) == signature_count;
+			written = fclose(file) == 0 && written;
+
+			if (!written || !MoveFileExA(temporary_path, path, MOVEFILE_REPLACE_EXISTING))
+			{
+				DeleteFileA(temporary_path);
+			}
+		}
+	}
+
+	return false;
+})");
+
+	return std::make_pair(generator.get_header(), generator.get_source());
+}
+
 /*
 
 int main()
@@ -1,24 +1,54 @@
 #pragma once
 #include "signature_item.hpp"
+#include <functional>
 #include <memory>
 #include <string>
+#include <ostream>
+#include <vector>
 #include <unordered_map>
+#include <map>
+#include <set>
+
+class code_generator;
 
 class signature_export
 {
 public:
+	typedef std::pair<const std::string, std::shared_ptr<signature_item>> signature_entry;
+
 	signature_export(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &class_name = "");
 	~signature_export();
 
 	bool save_source(const std::string &path);
 	bool save_header(const std::string &path);
 
-	static bool save(const std::string &file, const std::string &data);
+	//an unchanged file is left untouched
+	static bool save(const std::string &file, const std::string &data, bool *written = nullptr);
+	//streams writer straight into a buffered file_sink
+	static bool save(const std::string &file, const std::function<void(std::ostream &)> &writer, bool *written = nullptr);
 
 	static std::string make_header(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &prefix = "");
+	static void write_header(std::ostream &os, const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &prefix = "");
+
+	//header-only export of constexpr constants
+	static std::string make_constexpr_header(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &name_space = "");
+
+	//enum indexed table with a perfect hash name lookup, returns header and source
+	static std::pair<std::string, std::string> make_table(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &class_name = "");
+
+	//one header per name prefix plus file_stem.h including them, keyed by file name
+	static std::map<std::string, std::string> make_sharded_header(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &prefix, const std::string &file_stem);
+
+	//scans module_name when constructed, baked_names receives the rows it cannot scan for
+	static std::pair<std::string, std::string> make_resolver(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures, const std::string &class_name = "", const std::string &module_name = "", std::vector<std::string> *baked_names = nullptr);
 
 private:
+	//entries ordered by name, without copying them
+	static std::vector<const signature_entry *> sort(const std::unordered_map<std::string, std::shared_ptr<signature_item>> &signatures);
+
+	static void write_defines(std::ostream &os, const std::vector<const signature_entry *> &signatures, const std::string &prefix, std::set<std::string> &defined_names);
+	static std::string get_group(const std::string &name);
+
 	std::string class_name;
-	std::string header;
-	std::string source;
+	std::unique_ptr<code_generator> generator;
 };
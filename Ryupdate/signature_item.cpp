@@ -1,13 +1,19 @@
 #include "signature_item.hpp"
 #include "aobscan.hpp"
+#include "pattern.hpp"
+#include "scan_context.hpp"
+#include "x86_decoder.hpp"
 
 #include "disassembler.hpp"
 
 #include "ryupdate.hpp"
+#include <algorithm>
+#include <cstring>
 #include <functional>
 #include <dbghelp.h>
 #include <Psapi.h>
 
+#undef min
 #undef max
 
 signature_item::signature_item(QWidget *parent, const std::string &name, item_type type, const std::string &signature, size_t result, const std::string &data, const std::string &comments)
@@ -19,6 +25,20 @@ signature_item::signature_item(QWidget *parent, const std::string &name, item_ty
 	this->result = result;
 	this->data = data;
 	this->comments = comments;
+	this->address = 0;
+	this->build = 0;
+	this->section_offset = 0;
+	this->scope = 0;
+	this->instruction_index = 0;
+	this->byte_offset = 0;
+	this->instruction_address = 0;
+	this->value = 0;
+	this->xref = xref_none;
+	this->aligned = false;
+	this->function_start = false;
+	this->relocatable = false;
+	this->function_address = 0;
+	this->modified = true;
 
 	name_widget = new QTableWidgetItem(QString::fromStdString(name));
 
@@ -27,7 +47,16 @@ signature_item::signature_item(QWidget *parent, const std::string &name, item_ty
 	type_widget->setFont(QFont("Segoe UI", 8));
 	type_widget->setCurrentIndex(this->type - 1);
 
-	signature_widget = new QTableWidgetItem(QString::fromStdString(aobscan(signature).get_pattern()));
+	std::string normalized = signature;
+	try
+	{
+		normalized = pattern(signature).get_pattern();
+	}
+	catch (std::exception &)
+	{
+	}
+
+	signature_widget = new QTableWidgetItem(QString::fromStdString(normalized));
 	signature_widget->setFont(QFont("Consolas", 8));
 
 	result_widget = std::move(std::make_unique<QSpinBox>(parent));
@@ -43,11 +72,13 @@ signature_item::signature_item(QWidget *parent, const std::string &name, item_ty
 	connect(type_widget.get(), static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), [this](int) 
 	{
 		this->type = static_cast<item_type>(type_widget->currentIndex() + 1);
+		this->modified = true;
 	});
 
 	connect(result_widget.get(), static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this](int) 
 	{
 		this->result = result_widget->value();
+		this->modified = true;
 	});
 }
 
@@ -55,7 +86,7 @@ signature_item::~signature_item()
 {
 }
 
-void signature_item::update_data(const std::pair<address_t, size_t> &scan_region)
+std::pair<address_t, size_t> signature_item::resolve_region(const std::pair<address_t, size_t> &scan_region)
 {
 	void *pbase = reinterpret_cast<void *>(scan_region.first);
 	size_t size = scan_region.second;
@@ -100,83 +131,630 @@ void signature_item::update_data(const std::pair<address_t, size_t> &scan_region
 		getmodulesize(GetModuleHandle(0), &pbase, &size);
 	}
 
-	if (this->signature.empty())
+	return std::make_pair(reinterpret_cast<address_t>(pbase), size);
+}
+
+void signature_item::update_data(scan_context &context, const signature_item *parent)
+{
+	std::unique_ptr<pattern> compiled;
+
+	this->value = 0;
+
+	try
+	{
+		//rows resolved through the indexes may go without a signature
+		if (!this->signature.empty() || (this->xref == xref_none && this->symbol.empty()))
+		{
+			compiled = std::make_unique<pattern>(this->signature);
+		}
+	}
+	catch (std::exception &)
 	{
+		this->address = 0;
+		this->hits.clear();
 		this->data_widget->setText("ERROR");
 		return;
 	}
 
-	unsigned long address = aobscan(this->signature, pbase, size, this->result).address<unsigned long>();
+	std::vector<uint32_t> current_hits;
+	bool found = false;
+
+	if (this->xref != xref_none)
+	{
+		found = this->find_xref_hits(compiled.get(), context, parent, current_hits);
+	}
+	else if (!this->symbol.empty())
+	{
+		found = this->find_symbol_hits(compiled.get(), context, current_hits);
+	}
+	else
+	{
+		found = this->parent.empty() ? this->find_hits(*compiled, context, current_hits) : this->find_scoped_hits(*compiled, context, parent, current_hits);
+	}
+	unsigned long address = found ? static_cast<unsigned long>(context.get_address() + current_hits.back()) : 0;
+
+	this->address = address;
+	this->hits = address ? current_hits : std::vector<uint32_t>();
+	this->build = address ? context.get_pages().get_build() : 0;
+
+	if (address)
+	{
+		const pe_image::section *s = context.get_image().find_section(current_hits.back());
+		this->section = s ? s->name : "";
+		this->section_offset = s ? current_hits.back() - s->virtual_address : 0;
+
+		//sub_00401000+1A, x86 images are not swept just for it
+		const function_index::function *f = context.has_functions() ? context.get_functions().find(current_hits.back()) : nullptr;
+		this->function_address = f ? static_cast<address_t>(context.get_address() + f->begin) : 0;
+		this->name_widget->setToolTip(f ? QString::fromStdString("sub_" + hexadecimal_to_string(this->function_address) + "+" + hexadecimal_to_string(static_cast<address_t>(current_hits.back() - f->begin))) : QString());
+	}
+	else
+	{
+		this->function_address = 0;
+		this->name_widget->setToolTip(QString());
+	}
 
 	if (!address)
 	{
+		this->instruction_address = 0;
 		this->data_widget->setText("ERROR");
 		return;
 	}
 
+	//common forms are decoded in place, capstone decodes the rest
+	address_t start = static_cast<address_t>(address + this->byte_offset);
+	const scan_context::decoding *decoded = nullptr;
+	x86_decoder::instruction fast = {};
+
+	this->instruction_address = start;
+
+	if (this->instruction_index != 0 || type != type_address)
+	{
+		if (context.decode(start, this->instruction_index, fast, type != type_address))
+		{
+			this->instruction_address = fast.address;
+		}
+		else
+		{
+			//15 bytes is the longest x86 instruction
+			decoded = &context.disassemble(start, 15 * (this->instruction_index + 1));
+
+			if (decoded->instructions.size() <= this->instruction_index)
+			{
+				this->instruction_address = 0;
+				this->data_widget->setText("ERROR");
+				return;
+			}
+
+			this->instruction_address = static_cast<address_t>(decoded->instructions.at(this->instruction_index).address);
+		}
+	}
+
 	if (type == type_address)
 	{
-		this->data_widget->setText(QString::fromStdString(uint_to_string<address_t>(address)));
+		this->value = this->instruction_address;
+		this->data_widget->setText(this->resolve(context, this->value) ? QString::fromStdString(uint_to_string<address_t>(this->value)) : "ERROR");
+		return;
 	}
-	else
+
+	//capstone results are brought into the form of the fast decoder
+	if (decoded != nullptr)
+	{
+		const instruction &selected = decoded->instructions.at(this->instruction_index);
+		disassembler &disassemble = *decoded->disassembly;
+
+		fast.address = this->instruction_address;
+		fast.mnemonic = selected.mnemonic.c_str();
+		fast.op_count = 0;
+
+		cs_x86 x = selected.detail->x86;
+		for (size_t n = 0; n < x.op_count && n < 3; ++n)
+		{
+			const cs_x86_op &operand = x.operands[n];
+			x86_decoder::operand &converted = fast.operands[fast.op_count++];
+
+			converted = {x86_decoder::operand::operand_reg, nullptr, nullptr, 1, 0, 0};
+
+			switch (operand.type)
+			{
+			case X86_OP_REG:
+				converted.reg = cs_reg_name(disassemble.handle, operand.reg);
+				break;
+
+			case X86_OP_IMM:
+				converted.type = x86_decoder::operand::operand_imm;
+				converted.imm = operand.imm;
+				break;
+
+			case X86_OP_MEM:
+				converted.type = x86_decoder::operand::operand_mem;
+				converted.reg = operand.mem.base != 0 ? cs_reg_name(disassemble.handle, static_cast<x86_reg>(operand.mem.base)) : nullptr;
+				converted.index = operand.mem.index != 0 ? cs_reg_name(disassemble.handle, static_cast<x86_reg>(operand.mem.index)) : nullptr;
+				converted.scale = operand.mem.scale;
+				converted.disp = operand.mem.disp;
+				break;
+
+			default:
+				converted.type = x86_decoder::operand::operand_other;
+				break;
+			}
+		}
+	}
+
+	//stages resolve addresses, mnemonics and registers have none
+	if (type == type_operator)
+	{
+		this->data_widget->setText(this->stages.empty() ? QString::fromUtf8(fast.mnemonic).toUpper() : "ERROR");
+		return;
+	}
+
+	//operand 1 = 3, if type == 3, then 3 - 3 = 0
+	size_t operand_index = static_cast<size_t>(type - type_operand_1);
+
+	if (fast.op_count < operand_index + 1)
 	{
-		disassembler disassemble(static_cast<address_t>(address), z.readmemory(address, 12));
-		std::vector<instruction> instructions = disassemble.get_instructions();
+		this->data_widget->setText("ERROR");
+		return;
+	}
 
-		if (type == type_operator)
+	const x86_decoder::operand &operand = fast.operands[operand_index];
+
+	switch (operand.type)
+	{
+	case x86_decoder::operand::operand_reg:
+		this->data_widget->setText(this->stages.empty() ? QString::fromUtf8(operand.reg).toUpper() : "ERROR");
+		break;
+
+	case x86_decoder::operand::operand_imm:
+		this->value = static_cast<address_t>(operand.imm);
+		this->data_widget->setText(this->resolve(context, this->value) ? QString::fromStdString(hexadecimal_to_string(this->value)) : "ERROR");
+		break;
+
+	case x86_decoder::operand::operand_mem:
+		if (operand.reg != nullptr)
 		{
-			this->data_widget->setText(QString::fromStdString(instructions.at(0).mnemonic).toUpper());
+			this->comments_widget->setText(QString::fromUtf8(operand.reg).toUpper() + "+" + QString::fromStdString(hexadecimal_to_string(static_cast<address_t>(operand.disp))));
+		}
+
+		//only displacements without a base or index are addresses
+		if (!this->stages.empty() && (operand.reg != nullptr || operand.index != nullptr))
+		{
+			this->data_widget->setText("ERROR");
+		}
+		else if (operand.disp != 0)
+		{
+			this->value = static_cast<address_t>(operand.disp);
+			this->data_widget->setText(this->resolve(context, this->value) ? QString::fromStdString(hexadecimal_to_string(this->value)) : "ERROR");
+		}
+		else if (operand.reg != nullptr)
+		{
+			this->data_widget->setText(QString::fromUtf8(operand.reg).toUpper());
+		}
+		else
+		{
+			this->data_widget->setText("ERROR");
+		}
+		break;
+
+	default:
+		this->data_widget->setText("ERROR");
+		break;
+	}
+}
+
+bool signature_item::resolve(scan_context &context, address_t &resolved) const
+{
+	//pointers may lead out of the region, they are read through zephyrus
+	auto read_pointer = [](address_t at) -> address_t {
+		std::vector<uint8_t> pointer = z.readmemory(at, sizeof(address_t));
+
+		address_t value = 0;
+		if (pointer.size() == sizeof(address_t))
+		{
+			memcpy(&value, pointer.data(), sizeof(address_t));
+		}
+
+		return value;
+	};
+
+	for (stage_type stage : this->stages)
+	{
+		if (resolved == 0)
+		{
+			break;
+		}
+
+		if (stage == stage_dereference)
+		{
+			resolved = read_pointer(resolved);
+			continue;
+		}
+
+		//every unprefixed branch form is decoded in place
+		x86_decoder::instruction branch = {};
+		if (!context.decode(resolved, 0, branch) || branch.op_count != 1 || (branch.mnemonic[0] != 'j' && strcmp(branch.mnemonic, "call") != 0))
+		{
+			resolved = 0;
+			break;
+		}
+
+		const x86_decoder::operand &target = branch.operands[0];
+		if (target.type == x86_decoder::operand::operand_imm)
+		{
+			resolved = static_cast<address_t>(target.imm);
+		}
+		else if (target.type == x86_decoder::operand::operand_mem && target.reg == nullptr && target.index == nullptr)
+		{
+			//jmp [iat slot] of import thunks, the slot holds the target
+			resolved = read_pointer(static_cast<address_t>(target.disp));
 		}
 		else
 		{
-			cs_x86 x = instructions.at(0).detail->x86;
+			resolved = 0;
+		}
+	}
 
-			//operand 1 = 3, if type == 3, then 3 - 3 = 0
-			size_t operand_index = static_cast<size_t>(type - type_operand_1);
+	return resolved != 0 || this->stages.empty();
+}
 
-			if (x.op_count < operand_index + 1)
+std::string signature_item::format_stages(const std::vector<stage_type> &stages)
+{
+	static const char *const names[] = {"follow", "deref"};
+
+	std::string text;
+	for (stage_type stage : stages)
+	{
+		text += (text.empty() ? "" : " ") + std::string(names[stage]);
+	}
+
+	return text;
+}
+
+bool signature_item::parse_stages(const std::string &text, std::vector<stage_type> &stages)
+{
+	std::vector<stage_type> parsed;
+
+	std::istringstream words(text);
+	for (std::string word; words >> word;)
+	{
+		if (word == "follow")
+		{
+			parsed.push_back(stage_follow);
+		}
+		else if (word == "deref")
+		{
+			parsed.push_back(stage_dereference);
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	stages.swap(parsed);
+	return true;
+}
+
+bool signature_item::needs_scan(const scan_context &context) const
+{
+	if (!this->parent.empty() || this->xref != xref_none || !this->symbol.empty())
+	{
+		return false;
+	}
+
+	bool known = this->hits.size() == this->result && this->result != 0;
+	return !known || (this->build != context.get_pages().get_build() && (context.get_page_map() == nullptr || this->build != context.get_page_map()->get_previous_build()));
+}
+
+void signature_item::clear_hits()
+{
+	this->hits.clear();
+	this->build = 0;
+}
+
+bool signature_item::find_hits(const pattern &compiled, scan_context &context, std::vector<uint32_t> &current_hits)
+{
+	const uint8_t *base = context.get_base();
+	const page_map *pages = context.get_page_map();
+
+	current_hits.clear();
+
+	bool known = this->hits.size() == this->result && this->result != 0;
+
+	//same build, the hits stand as they are
+	if (known && this->build == context.get_pages().get_build())
+	{
+		bool valid = true;
+		for (uint32_t hit : this->hits)
+		{
+			valid = valid && static_cast<size_t>(hit) + compiled.size() <= context.get_size();
+			valid = valid && (this->relocatable ? compiled.match(base + hit, base, context.get_image().get_relocations()) : compiled.match(base + hit));
+			valid = valid && (!this->aligned || context.get_boundaries().is_boundary(hit));
+			valid = valid && (!this->function_start || context.get_functions().is_start(hit));
+		}
+
+		if (valid)
+		{
+			current_hits = this->hits;
+			return true;
+		}
+	}
+
+	//hits on pages that only moved are carried over, otherwise look where the last hit should be
+	if (known && !this->aligned && !this->function_start && !this->relocatable && pages != nullptr && this->build == pages->get_previous_build())
+	{
+		if (pages->carry(compiled, base, this->hits, current_hits))
+		{
+			if (!this->section.empty())
 			{
-				this->data_widget->setText("ERROR");
+				context.observe(this->section, this->section_offset, current_hits.back());
 			}
-			else
-			{
-				std::function<QString(const cs_x86_op &, size_t)> get_operand_data = [&](const cs_x86_op &operand, size_t operand_index) -> QString {
-					switch (operand.type)
-					{
-					case X86_OP_REG:
-						return QString::fromUtf8(cs_reg_name(disassemble.handle, x.operands[operand_index].reg)).toUpper();
 
-					case X86_OP_IMM:
-						return QString::fromStdString(hexadecimal_to_string(x.operands[operand_index].imm));
+			return true;
+		}
+
+		std::vector<int64_t> predictions;
+
+		int64_t shift = 0;
+		if (pages->get_shift(this->hits.back(), shift))
+		{
+			predictions.push_back(static_cast<int64_t>(this->hits.back()) + shift);
+		}
 
-					case X86_OP_MEM:
-						x86_op_mem mem = x.operands[operand_index].mem;
+		int64_t predicted = this->section.empty() ? -1 : context.predict(this->section, this->section_offset);
+		if (predicted != -1)
+		{
+			predictions.push_back(predicted);
+		}
 
-						printf("OPERATION_MEMORY_DETECTED (%s)\nBase: %d\tDisp: %llX\tIndex: %d\tScale: %d\tSegment: %d\n\n", this->name.c_str(), mem.base, mem.disp, mem.index, mem.scale, mem.segment);
+		//a hit is only taken once the page map proves there is no earlier one
+		for (size_t radius = 0x400; radius <= 0x40000; radius *= 4)
+		{
+			for (int64_t prediction : predictions)
+			{
+				size_t first = prediction > static_cast<int64_t>(radius) ? static_cast<size_t>(prediction) - radius : 0;
+				size_t last = std::min(static_cast<size_t>(std::max<int64_t>(prediction, 0)) + radius + compiled.size(), context.get_size());
 
-						if (mem.base != 0)
-						{
-							this->comments_widget->setText(QString::fromUtf8(cs_reg_name(disassemble.handle, static_cast<x86_reg>(mem.base))).toUpper() + "+" + QString::fromStdString(hexadecimal_to_string(mem.disp)));
-						}
-						if (mem.disp != 0)
-						{
-							return QString::fromStdString(hexadecimal_to_string(mem.disp));
-						}
-						if (mem.base != 0)
+				if (first >= last)
+				{
+					continue;
+				}
+
+				for (const uint8_t *p : compiled.find_all(base + first, base + last))
+				{
+					if (pages->verify(compiled, base, this->hits, static_cast<uint32_t>(p - base), current_hits))
+					{
+						if (!this->section.empty())
 						{
-							return QString::fromUtf8(cs_reg_name(disassemble.handle, static_cast<x86_reg>(mem.base))).toUpper();
+							context.observe(this->section, this->section_offset, current_hits.back());
 						}
 
-					default:
-						return "ERROR";
+						return true;
 					}
-				};
+				}
+			}
+		}
+	}
+
+	scan_context::alignment align = this->function_start ? scan_context::align_function : (this->aligned ? scan_context::align_instruction : scan_context::align_none);
+	current_hits = context.find_all(compiled, this->result, align, this->relocatable);
+
+	if (current_hits.size() != this->result)
+	{
+		return false;
+	}
+
+	if (known && !this->section.empty())
+	{
+		context.observe(this->section, this->section_offset, current_hits.back());
+	}
+
+	return true;
+}
+
+bool signature_item::find_scoped_hits(const pattern &compiled, scan_context &context, const signature_item *parent, std::vector<uint32_t> &current_hits)
+{
+	current_hits.clear();
+
+	if (parent == nullptr || parent->address == 0 || parent->hits.empty())
+	{
+		return false;
+	}
+
+	size_t first = parent->hits.back();
+	size_t last = this->scope != 0 ? std::min(first + this->scope, context.get_size()) : context.get_function_end(first);
+
+	//the scope bounds where a hit starts, not where it ends
+	last = std::min(last + compiled.size() - 1, context.get_size());
+
+	bool filtered = this->aligned || this->function_start;
+	size_t limit = filtered ? static_cast<size_t>(-1) : this->result;
+
+	const uint8_t *base = context.get_base();
+	std::vector<const uint8_t *> found = this->relocatable ? compiled.find_all(base + first, base + last, base, context.get_image().get_relocations(), limit) : compiled.find_all(base + first, base + last, limit);
+
+	for (const uint8_t *p : found)
+	{
+		size_t offset = static_cast<size_t>(p - base);
+		if ((!this->aligned || context.get_boundaries().is_boundary(offset)) && (!this->function_start || context.get_functions().is_start(offset)))
+		{
+			current_hits.push_back(static_cast<uint32_t>(offset));
+		}
+
+		if (current_hits.size() == this->result)
+		{
+			break;
+		}
+	}
+
+	return current_hits.size() == this->result;
+}
+
+bool signature_item::find_symbol_hits(const pattern *compiled, scan_context &context, std::vector<uint32_t> &current_hits)
+{
+	current_hits.clear();
+
+	//a symbol names one place
+	int64_t offset = this->find_symbol(context);
+	if (offset == -1 || this->result != 1 || (compiled != nullptr && !compiled->match_within(context.get_base() + offset, context.get_base() + context.get_size())))
+	{
+		return false;
+	}
+
+	current_hits.push_back(static_cast<uint32_t>(offset));
+	return true;
+}
+
+int64_t signature_item::find_symbol(const scan_context &context) const
+{
+	return this->symbol.find('!') != std::string::npos ? context.get_image().find_import(this->symbol) : context.get_image().find_export(this->symbol);
+}
+
+bool signature_item::find_xref_hits(const pattern *compiled, scan_context &context, const signature_item *parent, std::vector<uint32_t> &current_hits)
+{
+	current_hits.clear();
+
+	std::vector<uint32_t> targets;
+	if (!this->literal.empty())
+	{
+		targets = context.get_strings().find(this->literal);
+	}
+	else if (!this->symbol.empty())
+	{
+		int64_t offset = this->find_symbol(context);
+		if (offset != -1)
+		{
+			targets.push_back(static_cast<uint32_t>(offset));
+		}
+	}
+	else if (parent != nullptr && parent->address != 0 && parent->value >= context.get_address() && parent->value - context.get_address() < context.get_size())
+	{
+		targets.push_back(static_cast<uint32_t>(parent->value - context.get_address()));
+	}
+
+	//references to all copies of a string count in address order
+	std::vector<uint32_t> sources;
+	for (uint32_t target : targets)
+	{
+		std::vector<uint32_t> referencing = context.get_references().get_sources(target);
+		sources.insert(sources.end(), referencing.begin(), referencing.end());
+	}
 
-				//
-				this->data_widget->setText(get_operand_data(x.operands[operand_index], operand_index));
+	std::sort(sources.begin(), sources.end());
+
+	const uint8_t *base = context.get_base();
+	const uint8_t *end = base + context.get_size();
+
+	for (uint32_t source : sources)
+	{
+		if (compiled != nullptr && !compiled->match_within(base + source, end))
+		{
+			continue;
+		}
+
+		uint32_t hit = source;
+		if (this->xref == xref_functions)
+		{
+			const function_index::function *f = context.get_functions().find(source);
+			if (f == nullptr || std::find(current_hits.begin(), current_hits.end(), f->begin) != current_hits.end())
+			{
+				continue;
 			}
+
+			hit = f->begin;
+		}
+
+		current_hits.push_back(hit);
+
+		if (current_hits.size() == this->result)
+		{
+			break;
 		}
 	}
+
+	return current_hits.size() == this->result;
+}
+
+bool signature_item::get_operand_encoding(operand_encoding &encoding)
+{
+	if (type < type_operand_1 || this->address == 0)
+	{
+		return false;
+	}
+
+	size_t x = 0;
+	for (x = 0; x < data.size() && isxdigit(data.at(x)); ++x);
+
+	if (data.empty() || x != data.size())
+	{
+		return false;
+	}
+
+	//fields are located in the selected instruction, encodings stay relative to the hit
+	if (this->instruction_address < this->address)
+	{
+		return false;
+	}
+
+	size_t skip = this->instruction_address - this->address;
+
+	address_t value = static_cast<address_t>(std::stoull(data, nullptr, 16));
+	std::vector<uint8_t> bytes = z.readmemory(this->instruction_address, 15);
+
+	x86_decoder::fields fields = {};
+	if (!x86_decoder::get_fields(bytes.data(), bytes.size(), fields))
+	{
+		return false;
+	}
+
+	//the generated reader zero-extends a field, rel32 is the only relative form it can add
+	auto holds = [&](size_t offset, size_t size, bool relative)
+	{
+		if (size == 0 || size > sizeof(address_t) || (relative && size != 4))
+		{
+			return false;
+		}
+
+		address_t field = 0;
+		memcpy(&field, bytes.data() + offset, size);
+		return (relative ? static_cast<address_t>(this->instruction_address + fields.length + field) : field) == value;
+	};
+
+	bool displacement = holds(fields.displacement_offset, fields.displacement_size, false);
+	bool immediate = holds(fields.immediate_offset, fields.immediate_size, false);
+	bool relative = holds(fields.immediate_offset, fields.immediate_size, true);
+
+	//forms left to capstone need the value to name exactly one field
+	x86_decoder::instruction decoded = {};
+	size_t operand_index = static_cast<size_t>(type - type_operand_1);
+
+	if (x86_decoder::decode(bytes.data(), bytes.size(), this->instruction_address, decoded) && operand_index < decoded.op_count)
+	{
+		x86_decoder::operand::operand_type kind = decoded.operands[operand_index].type;
+		displacement = displacement && kind == x86_decoder::operand::operand_mem;
+		immediate = immediate && kind == x86_decoder::operand::operand_imm;
+		relative = relative && kind == x86_decoder::operand::operand_imm;
+	}
+
+	if (displacement + immediate + relative != 1)
+	{
+		return false;
+	}
+
+	if (relative)
+	{
+		encoding = {skip + fields.immediate_offset, fields.immediate_size, skip + fields.length, true};
+	}
+	else if (immediate)
+	{
+		encoding = {skip + fields.immediate_offset, fields.immediate_size, 0, false};
+	}
+	else
+	{
+		encoding = {skip + fields.displacement_offset, fields.displacement_size, 0, false};
+	}
+
+	return true;
 }
 
 std::string signature_item::hexadecimal_to_string(address_t value)
@@ -6,11 +6,14 @@
 #include <QSpinBox>
 
 #include <memory>
+#include <vector>
 #include <sstream>
-#include <iomanip>
 
 #include "zephyrus.hpp"
 
+class scan_context;
+class pattern;
+
 class signature_item : public QObject
 {
 	Q_OBJECT
@@ -25,6 +28,28 @@ public:
 		type_operand_3
 	};
 
+	//applied in order, a stage that fails fails the row
+	enum stage_type : uint32_t
+	{
+		//target of the call or jump at the address, through the slot of jmp [slot] thunks
+		stage_follow,
+
+		//pointer stored at the address
+		stage_dereference
+	};
+
+	//hits taken from the references to the parent's value
+	enum xref_type : uint32_t
+	{
+		xref_none,
+
+		//instructions referencing the value
+		xref_instructions,
+
+		//functions holding those instructions, each counted once
+		xref_functions
+	};
+
 	explicit signature_item(
 		QWidget *parent,
 		const std::string &name,
@@ -51,18 +76,138 @@ public:
 	QTableWidgetItem *data_widget;
 	QTableWidgetItem *comments_widget;
 
-	void update_data(const std::pair<address_t, size_t> &scan_region);
+	//address of the last hit, 0 if the last scan failed
+	address_t address;
+
+	//offsets inside the region, kept across builds
+	std::vector<uint32_t> hits;
+
+	//page hash of the build the hits were found in
+	uint64_t build;
+
+	//where to look in the next build
+	std::string section;
+	uint32_t section_offset;
+
+	//row whose hit scopes this one, empty to scan the whole region
+	std::string parent;
+
+	//bytes after the parent's hit that are searched, 0 for the rest of the parent's function
+	size_t scope;
+
+	//counted from the hit moved by byte_offset
+	size_t instruction_index;
+	int32_t byte_offset;
+
+	//address of that instruction, 0 if the last scan failed
+	address_t instruction_address;
+
+	//the data column as a number, 0 for registers, mnemonics and failed scans
+	address_t value;
+
+	//resolution of the value, "follow deref" in saved rows
+	std::vector<stage_type> stages;
+
+	//xref rows keep the signature empty or use it to filter the referencing instructions
+	xref_type xref;
+
+	//xref rows take the references to every copy of it
+	std::string literal;
+
+	//"module!function" is an iat slot, any other name an export, resolved without a scan
+	std::string symbol;
+
+	//only hits that start an instruction count
+	bool aligned;
+
+	//only function starts are tested
+	bool function_start;
+
+	//bytes the loader relocates are not compared
+	bool relocatable;
+
+	//start of the function holding the last hit, 0 without one
+	address_t function_address;
+
+	//changed since the last save, journaled saves only write these rows
+	bool modified;
+
+	//relative to the hit, not to the selected instruction
+	struct operand_encoding
+	{
+		size_t offset;
+		size_t size;
+		//instruction length, relative fields are added to the next instruction address
+		size_t length;
+		bool relative;
+	};
+
+	//parent is the row named by parent, updated in the same context before this one
+	void update_data(scan_context &context, const signature_item *parent = nullptr);
+
+	//true when update_data can only find the row by scanning the whole region
+	bool needs_scan(const scan_context &context) const;
+
+	//forgets the hits of earlier scans, for edits that change which hits the row counts
+	void clear_hits();
+
+	//region (0, 0) is the main module
+	static std::pair<address_t, size_t> resolve_region(const std::pair<address_t, size_t> &scan_region);
+
+	bool get_operand_encoding(operand_encoding &encoding);
 
 	static std::string hexadecimal_to_string(address_t value);
 
+	static std::string format_stages(const std::vector<stage_type> &stages);
+
+	//false on unknown stage names, stages is left as it was
+	static bool parse_stages(const std::string &text, std::vector<stage_type> &stages);
+
 	template <typename T>
 	static std::string uint_to_string(T value);
+
+	//writes exactly sizeof(T) * 2 upper case hex digits, no terminator
+	template <typename T>
+	static char *uint_to_chars(char *first, T value);
+
+private:
+	//reuses the hits of an earlier build where it can prove them
+	bool find_hits(const pattern &compiled, scan_context &context, std::vector<uint32_t> &current_hits);
+
+	//hits behind the parent's hit
+	bool find_scoped_hits(const pattern &compiled, scan_context &context, const signature_item *parent, std::vector<uint32_t> &current_hits);
+
+	//the import slot or export the symbol names, filtered by the signature when there is one
+	bool find_symbol_hits(const pattern *compiled, scan_context &context, std::vector<uint32_t> &current_hits);
+
+	//runs the stages on resolved, false and 0 if one of them fails
+	bool resolve(scan_context &context, address_t &resolved) const;
+
+	//offset of the symbol in the region, -1 if it is not imported or exported
+	int64_t find_symbol(const scan_context &context) const;
+
+	//compiled is nullptr without a signature
+	bool find_xref_hits(const pattern *compiled, scan_context &context, const signature_item *parent, std::vector<uint32_t> &current_hits);
 };
 
 template <typename T>
 inline std::string signature_item::uint_to_string(T value)
 {
-	std::stringstream ss;
-	ss << std::setfill('0') << std::setw(sizeof(T) * 2) << std::uppercase << std::hex << static_cast<address_t>(value);
-	return ss.str();
+	char buffer[sizeof(T) * 2];
+	return std::string(buffer, uint_to_chars<T>(buffer, value));
+}
+
+template <typename T>
+inline char *signature_item::uint_to_chars(char *first, T value)
+{
+	static const char digits[] = "0123456789ABCDEF";
+
+	address_t x = static_cast<address_t>(value);
+	for (size_t n = sizeof(T) * 2; n != 0; --n)
+	{
+		first[n - 1] = digits[x & 0xF];
+		x >>= 4;
+	}
+
+	return first + sizeof(T) * 2;
 }
@@ -0,0 +1,272 @@
+#define NOMINMAX
+
+#include "signature_journal.hpp"
+#include "file_sink.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <windows.h>
+
+using namespace nlohmann;
+
+signature_journal::signature_journal()
+	: compacting(false)
+{
+}
+
+signature_journal::~signature_journal()
+{
+	this->wait();
+}
+
+bool signature_journal::save_snapshot(const std::string &path, const json &rows)
+{
+	this->wait();
+
+	if (!write_snapshot(path, rows))
+	{
+		return false;
+	}
+
+	//everything the journals held is in the snapshot now
+	DeleteFileA((path + ".journal").c_str());
+	DeleteFileA((path + ".compacting").c_str());
+
+	this->path = path;
+	return true;
+}
+
+bool signature_journal::append(const std::string &path, const json &changed, const std::vector<std::string> &erased)
+{
+	if (path.compare(this->path))
+	{
+		return false;
+	}
+
+	std::string journal_path = path + ".journal";
+
+	std::stringstream records;
+	for (const std::string &name : erased)
+	{
+		records << json{{"erase", name}}.dump() << '\n';
+	}
+
+	for (const json &row : changed)
+	{
+		records << json{{"set", row}}.dump() << '\n';
+	}
+
+	std::string data = records.str();
+	if (!data.empty())
+	{
+		HANDLE file = CreateFileA(journal_path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		DWORD written = 0;
+		bool result = WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) && written == data.size();
+		result = FlushFileBuffers(file) && result;
+		CloseHandle(file);
+
+		if (!result)
+		{
+			return false;
+		}
+	}
+
+	if (!compacting && file_size(journal_path) > std::max<uint64_t>(1 << 20, file_size(path) / 2))
+	{
+		this->compact();
+	}
+
+	return true;
+}
+
+json signature_journal::load(const std::string &path)
+{
+	json rows = json::object();
+
+	std::ifstream fs(path);
+	std::stringstream ss;
+	ss << fs.rdbuf();
+
+	if (!ss.str().empty())
+	{
+		rows = json::parse(ss.str());
+	}
+
+	//older journal first, a crash may have left one behind mid-compaction
+	replay(rows, path + ".compacting");
+	replay(rows, path + ".journal");
+
+	return rows;
+}
+
+const std::string &signature_journal::get_path() const
+{
+	return path;
+}
+
+void signature_journal::set_path(const std::string &path)
+{
+	this->wait();
+	this->path = path;
+
+	if (!path.empty())
+	{
+		repair(path + ".compacting");
+		repair(path + ".journal");
+	}
+}
+
+void signature_journal::replay(json &rows, const std::string &journal_path)
+{
+	std::ifstream fs(journal_path);
+	std::string line;
+
+	while (std::getline(fs, line))
+	{
+		json record = json::parse(line, nullptr, false);
+		if (record.is_discarded())
+		{
+			//torn write, nothing after it was acknowledged
+			break;
+		}
+
+		if (record.count("set"))
+		{
+			const json &row = record["set"];
+			rows[row["name"].get<std::string>()] = row;
+		}
+		else if (record.count("erase"))
+		{
+			rows.erase(record["erase"].get<std::string>());
+		}
+	}
+}
+
+bool signature_journal::repair(const std::string &journal_path)
+{
+	std::ifstream fs(journal_path, std::ios::binary);
+	if (!fs.is_open())
+	{
+		return true;
+	}
+
+	std::stringstream ss;
+	ss << fs.rdbuf();
+	fs.close();
+
+	std::string data = ss.str();
+	size_t keep = 0;
+	bool terminate = false;
+
+	while (keep < data.size())
+	{
+		size_t end = data.find('\n', keep);
+		if (json::parse(data.substr(keep, end == std::string::npos ? std::string::npos : end - keep), nullptr, false).is_discarded())
+		{
+			break;
+		}
+
+		//whole record without its newline, replay applied it
+		terminate = end == std::string::npos;
+		keep = terminate ? data.size() : end + 1;
+	}
+
+	if (keep == data.size() && !terminate)
+	{
+		return true;
+	}
+
+	HANDLE file = CreateFileA(journal_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER position;
+	position.QuadPart = static_cast<LONGLONG>(keep);
+
+	DWORD written = 0;
+	bool result = SetFilePointerEx(file, position, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+	result = result && (!terminate || (WriteFile(file, "\n", 1, &written, nullptr) && written == 1));
+	result = FlushFileBuffers(file) && result;
+	CloseHandle(file);
+
+	return result;
+}
+
+bool signature_journal::write_snapshot(const std::string &path, const json &rows)
+{
+	//file_sink writes a temporary file and renames it over the snapshot
+	file_sink sink(path);
+	std::ostream os(&sink);
+
+	os << rows.dump();
+	os.flush();
+
+	return sink.close() && os.good();
+}
+
+uint64_t signature_journal::file_size(const std::string &path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data))
+	{
+		return 0;
+	}
+
+	return (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+}
+
+void signature_journal::compact()
+{
+	this->wait();
+
+	std::string journal_path = path + ".journal";
+	std::string compacting_path = path + ".compacting";
+
+	//appends go to a fresh journal while the old one is folded in
+	if (GetFileAttributesA(compacting_path.c_str()) == INVALID_FILE_ATTRIBUTES &&
+		!MoveFileExA(journal_path.c_str(), compacting_path.c_str(), MOVEFILE_WRITE_THROUGH))
+	{
+		return;
+	}
+
+	compacting = true;
+
+	std::string snapshot_path = path;
+	compaction = std::thread([this, snapshot_path, compacting_path]() {
+		json rows = json::object();
+
+		std::ifstream fs(snapshot_path);
+		std::stringstream ss;
+		ss << fs.rdbuf();
+		fs.close();
+
+		json snapshot = ss.str().empty() ? json::object() : json::parse(ss.str(), nullptr, false);
+		if (!snapshot.is_discarded())
+		{
+			rows = snapshot;
+			replay(rows, compacting_path);
+
+			if (write_snapshot(snapshot_path, rows))
+			{
+				DeleteFileA(compacting_path.c_str());
+			}
+		}
+
+		compacting = false;
+	});
+}
+
+void signature_journal::wait()
+{
+	if (compaction.joinable())
+	{
+		compaction.join();
+	}
+}
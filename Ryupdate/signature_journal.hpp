@@ -0,0 +1,50 @@
+#pragma once
+#include "json.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+//snapshot file plus an append-only journal of changed rows
+//
+//	path				json snapshot, object of rows keyed by name
+//	path.journal		one json record per line, {"set": row} or {"erase": name}
+//	path.compacting		journal being folded into the snapshot in the background
+//
+//the snapshot is only replaced by a rename, a torn journal line ends the replay
+class signature_journal
+{
+public:
+	signature_journal();
+	~signature_journal();
+
+	//full rewrite, the journal starts empty
+	bool save_snapshot(const std::string &path, const nlohmann::json &rows);
+
+	//compacts in the background once the journal outgrows the snapshot
+	bool append(const std::string &path, const nlohmann::json &changed, const std::vector<std::string> &erased);
+
+	//snapshot with every journal replayed on top
+	static nlohmann::json load(const std::string &path);
+
+	//empty without a single file, setting it repairs journals torn by a crash
+	const std::string &get_path() const;
+	void set_path(const std::string &path);
+
+private:
+	static void replay(nlohmann::json &rows, const std::string &journal_path);
+
+	//cuts a journal back to its last complete record
+	static bool repair(const std::string &journal_path);
+
+	static bool write_snapshot(const std::string &path, const nlohmann::json &rows);
+	static uint64_t file_size(const std::string &path);
+
+	void compact();
+	void wait();
+
+	std::string path;
+	std::thread compaction;
+	std::atomic<bool> compacting;
+};
@@ -0,0 +1,81 @@
+#include "string_index.hpp"
+
+#include <algorithm>
+
+string_index::string_index()
+{
+}
+
+string_index::string_index(const uint8_t *base, size_t size, const pe_image &image)
+{
+	for (const pe_image::section &s : image.get_sections())
+	{
+		size_t first = s.virtual_address, last = std::min(static_cast<size_t>(s.virtual_address) + s.virtual_size, size);
+		if (s.executable || first >= last)
+		{
+			continue;
+		}
+
+		//ascii, a run of printable bytes ended by a terminator
+		for (size_t n = first; n < last;)
+		{
+			size_t end = n;
+			while (end < last && is_printable(base[end]))
+			{
+				++end;
+			}
+
+			if (end < last && base[end] == 0 && end - n >= minimum_length)
+			{
+				strings[std::string(reinterpret_cast<const char *>(base + n), end - n)].push_back(static_cast<uint32_t>(n));
+			}
+
+			n = end + 1;
+		}
+
+		//wide strings are two byte aligned, only the ascii range is indexed
+		for (size_t n = first; n + 1 < last;)
+		{
+			std::string text;
+
+			size_t end = n;
+			while (end + 1 < last && base[end + 1] == 0 && is_printable(base[end]))
+			{
+				text.push_back(static_cast<char>(base[end]));
+				end += 2;
+			}
+
+			if (end + 1 < last && base[end] == 0 && base[end + 1] == 0 && text.size() >= minimum_length)
+			{
+				strings[text].push_back(static_cast<uint32_t>(n));
+			}
+
+			n = end + 2;
+		}
+	}
+
+	for (std::pair<const std::string, std::vector<uint32_t>> &p : strings)
+	{
+		std::sort(p.second.begin(), p.second.end());
+	}
+}
+
+string_index::~string_index()
+{
+}
+
+std::vector<uint32_t> string_index::find(const std::string &text) const
+{
+	auto it = strings.find(text);
+	return it != strings.end() ? it->second : std::vector<uint32_t>();
+}
+
+size_t string_index::get_count() const
+{
+	return strings.size();
+}
+
+bool string_index::is_printable(uint8_t c)
+{
+	return (c >= 0x20 && c < 0x7F) || c == '\t' || c == '\n' || c == '\r';
+}
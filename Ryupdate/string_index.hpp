@@ -0,0 +1,32 @@
+#pragma once
+#include "pe_image.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//ascii and utf-16 strings of the data sections
+class string_index
+{
+public:
+	string_index();
+
+	//base is the image mapped in memory
+	string_index(const uint8_t *base, size_t size, const pe_image &image);
+
+	~string_index();
+
+	//every copy, ascii and utf-16, sorted
+	std::vector<uint32_t> find(const std::string &text) const;
+
+	size_t get_count() const;
+
+private:
+	//shorter runs are mostly other data
+	static const size_t minimum_length = 4;
+
+	static bool is_printable(uint8_t c);
+
+	std::unordered_map<std::string, std::vector<uint32_t>> strings;
+};
@@ -0,0 +1,632 @@
+#include "x86_decoder.hpp"
+
+#include <cstring>
+#include <utility>
+
+size_t x86_decoder::get_length(const uint8_t *p, size_t size)
+{
+	parts found = {};
+	return get_length(p, size, found);
+}
+
+bool x86_decoder::get_fields(const uint8_t *p, size_t size, fields &found)
+{
+	parts measured = {};
+
+	size_t length = get_length(p, size, measured);
+	if (length == 0)
+	{
+		return false;
+	}
+
+	found = {length, 0, 0, measured.immediate, length - measured.immediate};
+
+	//memory offsets take the place of immediates
+	if (measured.flags & flag_imm32)
+	{
+		std::swap(found.displacement_offset, found.immediate_offset);
+		std::swap(found.displacement_size, found.immediate_size);
+		return true;
+	}
+
+	if (!(measured.flags & flag_modrm) || (p[measured.modrm] >> 6) == 3)
+	{
+		return true;
+	}
+
+	//the displacement ends where the immediates start
+	uint8_t mod = p[measured.modrm] >> 6, rm = p[measured.modrm] & 7;
+	if (measured.address_size)
+	{
+		found.displacement_size = (mod == 0 && rm == 6) || mod == 2 ? 2 : (mod == 1 ? 1 : 0);
+	}
+	else
+	{
+		bool sib_base = rm == 4 && (p[measured.modrm + 1] & 7) == 5;
+		found.displacement_size = mod == 1 ? 1 : (mod == 2 || (mod == 0 && (rm == 5 || sib_base)) ? 4 : 0);
+	}
+
+	found.displacement_offset = found.displacement_size != 0 ? measured.immediate - found.displacement_size : 0;
+	return true;
+}
+
+bool x86_decoder::get_memory_operand(const uint8_t *p, size_t size, operand &memory)
+{
+	static const char *const reg32[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"};
+	static const uint8_t prefixes[] = {0x26, 0x2E, 0x36, 0x3E, 0x64, 0x65, 0x66, 0x67, 0xF0, 0xF2, 0xF3};
+
+	parts measured = {};
+
+	size_t length = get_length(p, size, measured);
+	if (length == 0)
+	{
+		return false;
+	}
+
+	for (size_t n = 0; n < length && memchr(prefixes, p[n], sizeof(prefixes)); ++n)
+	{
+		if (p[n] == 0x64 || p[n] == 0x65 || p[n] == 0x67)
+		{
+			return false;
+		}
+	}
+
+	//memory offsets end the instruction
+	if (measured.flags & flag_imm32)
+	{
+		int32_t disp = 0;
+		memcpy(&disp, p + length - sizeof(disp), sizeof(disp));
+
+		memory = {operand::operand_mem, nullptr, nullptr, 1, 0, disp};
+		return true;
+	}
+
+	if (!(measured.flags & flag_modrm) || (p[measured.modrm] >> 6) == 3)
+	{
+		return false;
+	}
+
+	memory = get_modrm_operand(p + measured.modrm, reg32);
+	return true;
+}
+
+size_t x86_decoder::get_length(const uint8_t *p, size_t size, parts &found)
+{
+	const uint8_t _ = 0, M = flag_modrm, B = flag_imm8, W = flag_imm16, Z = flag_immz, D = flag_imm32, X = flag_other, P = flag_prefix, R = flag_register;
+	const uint8_t MB = M | B, MZ = M | Z, WB = W | B, ZW = Z | W;
+
+	//wait is left to capstone, which decodes it apart from the x87 instruction behind it
+	static const uint8_t one_byte[256] = {
+		M,  M,  M,  M,  B,  Z,  _,  _,  M,  M,  M,  M,  B,  Z,  _,  X,
+		M,  M,  M,  M,  B,  Z,  _,  _,  M,  M,  M,  M,  B,  Z,  _,  _,
+		M,  M,  M,  M,  B,  Z,  P,  _,  M,  M,  M,  M,  B,  Z,  P,  _,
+		M,  M,  M,  M,  B,  Z,  P,  _,  M,  M,  M,  M,  B,  Z,  P,  _,
+		_,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,
+		_,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,  _,
+		_,  _,  M,  M,  P,  P,  P,  P,  Z,  MZ, B,  MB, _,  _,  _,  _,
+		B,  B,  B,  B,  B,  B,  B,  B,  B,  B,  B,  B,  B,  B,  B,  B,
+		MB, MZ, MB, MB, M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,
+		_,  _,  _,  _,  _,  _,  _,  _,  _,  _,  ZW, X,  _,  _,  _,  _,
+		D,  D,  D,  D,  _,  _,  _,  _,  B,  Z,  _,  _,  _,  _,  _,  _,
+		B,  B,  B,  B,  B,  B,  B,  B,  Z,  Z,  Z,  Z,  Z,  Z,  Z,  Z,
+		MB, MB, W,  _,  M,  M,  MB, MZ, WB, _,  W,  _,  _,  B,  _,  _,
+		M,  M,  M,  M,  B,  B,  _,  _,  M,  M,  M,  M,  M,  M,  M,  M,
+		B,  B,  B,  B,  B,  B,  B,  B,  Z,  Z,  ZW, B,  _,  _,  _,  _,
+		P,  _,  P,  P,  _,  _,  M,  M,  _,  _,  _,  _,  _,  _,  M,  M};
+
+	//control, debug and test register moves ignore mod, 3dnow puts its opcode last like an immediate
+	static const uint8_t two_byte[256] = {
+		M,  M,  M,  M,  X,  _,  _,  _,  _,  _,  X,  _,  X,  M,  _,  MB,
+		M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,
+		R,  R,  R,  R,  R,  X,  R,  X,  M,  M,  M,  M,  M,  M,  M,  M,
+		_,  _,  _,  _,  _,  _,  X,  _,  X,  X,  X,  X,  X,  X,  X,  X,
+		M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,
+		M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,
+		M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,
+		MB, MB, MB, MB, M,  M,  M,  _,  M,  M,  X,  X,  M,  M,  M,  M,
+		Z,  Z,  Z,  Z,  Z,  Z,  Z,  Z,  Z,  Z,  Z,  Z,  Z,  Z,  Z,  Z,
+		M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,
+		_,  _,  _,  M,  MB, M,  X,  X,  _,  _,  _,  M,  MB, M,  M,  M,
+		M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  MB, M,  M,  M,  M,  M,
+		M,  M,  MB, M,  MB, MB, MB, M,  _,  _,  _,  _,  _,  _,  _,  _,
+		M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,
+		M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,
+		M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M,  M};
+
+	size = size < 15 ? size : 15;
+
+	size_t n = 0;
+	bool operand_size = false, address_size = false;
+
+	for (; n < size && (one_byte[p[n]] & flag_prefix); ++n)
+	{
+		operand_size = operand_size || p[n] == 0x66;
+		address_size = address_size || p[n] == 0x67;
+	}
+
+	if (n == size)
+	{
+		return 0;
+	}
+
+	uint8_t opcode = p[n++];
+	uint8_t flags = one_byte[opcode];
+
+	if (opcode == 0x0F)
+	{
+		if (n == size)
+		{
+			return 0;
+		}
+
+		uint8_t second = p[n++];
+		flags = two_byte[second];
+
+		if (second == 0x38 || second == 0x3A)
+		{
+			if (n == size)
+			{
+				return 0;
+			}
+
+			++n;
+			flags = second == 0x38 ? M : MB;
+		}
+	}
+	else if (n < size && (((opcode == 0xC4 || opcode == 0xC5 || opcode == 0x62) && (p[n] >> 6) == 3) || (opcode == 0x8F && ((p[n] >> 3) & 7) != 0)))
+	{
+		//vex, evex and xop reuse the invalid register forms of les, lds, bound and pop
+		size_t payload = opcode == 0xC5 ? 1 : (opcode == 0x62 ? 3 : 2);
+		if (n + payload >= size)
+		{
+			return 0;
+		}
+
+		uint8_t map = opcode == 0xC5 ? 1 : (opcode == 0x62 ? p[n] & 7 : p[n] & 0x1F);
+		uint8_t second = p[n + payload];
+		n += payload + 1;
+
+		if (opcode == 0x8F)
+		{
+			flags = map == 8 ? MB : (map == 9 ? M : (map == 10 ? MZ : X));
+		}
+		else if (map == 1)
+		{
+			flags = two_byte[second];
+		}
+		else if (map == 2 || (opcode == 0x62 && (map == 5 || map == 6)))
+		{
+			flags = M;
+		}
+		else
+		{
+			flags = map == 3 ? MB : X;
+		}
+	}
+
+	if (flags & flag_other)
+	{
+		return 0;
+	}
+
+	if (flags & flag_register)
+	{
+		if (n == size)
+		{
+			return 0;
+		}
+
+		++n;
+	}
+
+	if (flags & flag_modrm)
+	{
+		found.modrm = n;
+
+		size_t length = get_modrm_length(p + n, size - n, address_size);
+		if (length == 0)
+		{
+			return 0;
+		}
+
+		//test is the only member of its group taking an immediate
+		if ((opcode == 0xF6 || opcode == 0xF7) && ((p[n] >> 3) & 7) < 2)
+		{
+			flags |= opcode == 0xF6 ? B : Z;
+		}
+
+		n += length;
+	}
+
+	found.flags = flags;
+	found.immediate = n;
+	found.address_size = address_size;
+
+	n += (flags & flag_imm8) ? 1 : 0;
+	n += (flags & flag_imm16) ? 2 : 0;
+	n += (flags & flag_immz) ? (operand_size ? 2 : 4) : 0;
+	n += (flags & flag_imm32) ? (address_size ? 2 : 4) : 0;
+
+	return n <= size ? n : 0;
+}
+
+bool x86_decoder::decode(const uint8_t *p, size_t size, uint32_t address, instruction &decoded)
+{
+	static const char *const reg8[] = {"al", "cl", "dl", "bl", "ah", "ch", "dh", "bh"};
+	static const char *const reg16[] = {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di"};
+	static const char *const reg32[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"};
+
+	static const char *const alu[] = {"add", "or", "adc", "sbb", "and", "sub", "xor", "cmp"};
+	static const char *const jcc[] = {"jo", "jno", "jb", "jae", "je", "jne", "jbe", "ja", "js", "jns", "jp", "jnp", "jl", "jge", "jle", "jg"};
+
+	static const uint8_t prefixes[] = {0x26, 0x2E, 0x36, 0x3E, 0x64, 0x65, 0x66, 0x67, 0xF0, 0xF2, 0xF3};
+
+	size_t length = get_length(p, size);
+
+	//prefixes change how capstone names operands, those instructions are left to it
+	if (length == 0 || memchr(prefixes, p[0], sizeof(prefixes)))
+	{
+		return false;
+	}
+
+	decoded.address = address;
+	decoded.length = length;
+	decoded.mnemonic = nullptr;
+	decoded.op_count = 0;
+
+	auto add = [&](const operand &o) {
+		decoded.operands[decoded.op_count++] = o;
+	};
+
+	auto reg = [&](const char *name) {
+		add({operand::operand_reg, name, nullptr, 1, 0, 0});
+	};
+
+	auto imm = [&](int64_t value) {
+		add({operand::operand_imm, nullptr, nullptr, 1, value, 0});
+	};
+
+	//immediates end the instruction
+	auto imm8 = [&]() -> int64_t {
+		return static_cast<int8_t>(p[length - 1]);
+	};
+
+	auto imm32 = [&]() -> int64_t {
+		int32_t value = 0;
+		memcpy(&value, p + length - sizeof(value), sizeof(value));
+		return value;
+	};
+
+	auto target = [&](int64_t rel) -> int64_t {
+		return static_cast<uint32_t>(address + length + rel);
+	};
+
+	uint8_t opcode = p[0];
+	uint8_t field = length > 1 ? (p[1] >> 3) & 7 : 0;
+
+	if (opcode < 0x40 && ((opcode & 7) < 4 || (opcode & 7) == 5))
+	{
+		decoded.mnemonic = alu[opcode >> 3];
+
+		switch (opcode & 7)
+		{
+		case 0:
+			add(get_modrm_operand(p + 1, reg8));
+			reg(reg8[field]);
+			break;
+
+		case 1:
+			add(get_modrm_operand(p + 1, reg32));
+			reg(reg32[field]);
+			break;
+
+		case 2:
+			reg(reg8[field]);
+			add(get_modrm_operand(p + 1, reg8));
+			break;
+
+		case 3:
+			reg(reg32[field]);
+			add(get_modrm_operand(p + 1, reg32));
+			break;
+
+		case 5:
+			reg("eax");
+			imm(imm32());
+			break;
+		}
+
+		return true;
+	}
+
+	switch (opcode)
+	{
+	case 0x50: case 0x51: case 0x52: case 0x53: case 0x54: case 0x55: case 0x56: case 0x57:
+		decoded.mnemonic = "push";
+		reg(reg32[opcode & 7]);
+		break;
+
+	case 0x58: case 0x59: case 0x5A: case 0x5B: case 0x5C: case 0x5D: case 0x5E: case 0x5F:
+		decoded.mnemonic = "pop";
+		reg(reg32[opcode & 7]);
+		break;
+
+	case 0x68:
+		decoded.mnemonic = "push";
+		imm(imm32());
+		break;
+
+	case 0x6A:
+		decoded.mnemonic = "push";
+		imm(imm8());
+		break;
+
+	case 0x70: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: case 0x76: case 0x77:
+	case 0x78: case 0x79: case 0x7A: case 0x7B: case 0x7C: case 0x7D: case 0x7E: case 0x7F:
+		decoded.mnemonic = jcc[opcode & 0xF];
+		imm(target(imm8()));
+		break;
+
+	case 0x81:
+	case 0x83:
+		decoded.mnemonic = alu[field];
+		add(get_modrm_operand(p + 1, reg32));
+		imm(opcode == 0x81 ? imm32() : imm8());
+		break;
+
+	case 0x84:
+		decoded.mnemonic = "test";
+		add(get_modrm_operand(p + 1, reg8));
+		reg(reg8[field]);
+		break;
+
+	case 0x85:
+		decoded.mnemonic = "test";
+		add(get_modrm_operand(p + 1, reg32));
+		reg(reg32[field]);
+		break;
+
+	case 0x88:
+	case 0x89:
+		decoded.mnemonic = "mov";
+		add(get_modrm_operand(p + 1, opcode == 0x88 ? reg8 : reg32));
+		reg(opcode == 0x88 ? reg8[field] : reg32[field]);
+		break;
+
+	case 0x8A:
+	case 0x8B:
+		decoded.mnemonic = "mov";
+		reg(opcode == 0x8A ? reg8[field] : reg32[field]);
+		add(get_modrm_operand(p + 1, opcode == 0x8A ? reg8 : reg32));
+		break;
+
+	case 0x8D:
+		if ((p[1] >> 6) == 3)
+		{
+			return false;
+		}
+
+		decoded.mnemonic = "lea";
+		reg(reg32[field]);
+		add(get_modrm_operand(p + 1, reg32));
+		break;
+
+	case 0x8F:
+		if (field != 0)
+		{
+			return false;
+		}
+
+		decoded.mnemonic = "pop";
+		add(get_modrm_operand(p + 1, reg32));
+		break;
+
+	case 0x90:
+		decoded.mnemonic = "nop";
+		break;
+
+	case 0xA1:
+	case 0xA3:
+	{
+		operand moffs = {operand::operand_mem, nullptr, nullptr, 1, 0, imm32()};
+
+		decoded.mnemonic = "mov";
+		if (opcode == 0xA1)
+		{
+			reg("eax");
+			add(moffs);
+		}
+		else
+		{
+			add(moffs);
+			reg("eax");
+		}
+		break;
+	}
+
+	case 0xA9:
+		decoded.mnemonic = "test";
+		reg("eax");
+		imm(imm32());
+		break;
+
+	case 0xB8: case 0xB9: case 0xBA: case 0xBB: case 0xBC: case 0xBD: case 0xBE: case 0xBF:
+		decoded.mnemonic = "mov";
+		reg(reg32[opcode & 7]);
+		imm(imm32());
+		break;
+
+	case 0xC2:
+		decoded.mnemonic = "ret";
+		imm(p[1] | (p[2] << 8));
+		break;
+
+	case 0xC3:
+		decoded.mnemonic = "ret";
+		break;
+
+	case 0xC7:
+		if (field != 0)
+		{
+			return false;
+		}
+
+		decoded.mnemonic = "mov";
+		add(get_modrm_operand(p + 1, reg32));
+		imm(imm32());
+		break;
+
+	case 0xCC:
+		decoded.mnemonic = "int3";
+		break;
+
+	case 0xE8:
+		decoded.mnemonic = "call";
+		imm(target(imm32()));
+		break;
+
+	case 0xE9:
+		decoded.mnemonic = "jmp";
+		imm(target(imm32()));
+		break;
+
+	case 0xEB:
+		decoded.mnemonic = "jmp";
+		imm(target(imm8()));
+		break;
+
+	case 0xFF:
+	{
+		static const char *const group[] = {"inc", "dec", "call", nullptr, "jmp", nullptr, "push", nullptr};
+
+		if (group[field] == nullptr)
+		{
+			return false;
+		}
+
+		decoded.mnemonic = group[field];
+		add(get_modrm_operand(p + 1, reg32));
+		break;
+	}
+
+	case 0x0F:
+	{
+		uint8_t second = p[1];
+
+		if (second >= 0x80 && second <= 0x8F)
+		{
+			decoded.mnemonic = jcc[second & 0xF];
+			imm(target(imm32()));
+		}
+		else if (second == 0xB6 || second == 0xB7 || second == 0xBE || second == 0xBF)
+		{
+			decoded.mnemonic = second < 0xBE ? "movzx" : "movsx";
+			reg(reg32[(p[2] >> 3) & 7]);
+			add(get_modrm_operand(p + 2, (second & 1) ? reg16 : reg8));
+		}
+		else
+		{
+			return false;
+		}
+
+		break;
+	}
+
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+size_t x86_decoder::get_modrm_length(const uint8_t *p, size_t size, bool address_size)
+{
+	if (size == 0)
+	{
+		return 0;
+	}
+
+	uint8_t mod = p[0] >> 6, rm = p[0] & 7;
+	size_t length = 1;
+
+	if (mod == 3)
+	{
+		return length;
+	}
+
+	//16-bit addressing has no sib byte, only bp without a displacement is replaced by one
+	if (address_size)
+	{
+		length += (mod == 0 && rm == 6) || mod == 2 ? 2 : (mod == 1 ? 1 : 0);
+		return length <= size ? length : 0;
+	}
+
+	if (rm == 4)
+	{
+		if (size < 2)
+		{
+			return 0;
+		}
+
+		length = 2;
+		length += (mod == 0 && (p[1] & 7) == 5) ? 4 : 0;
+	}
+	else if (mod == 0 && rm == 5)
+	{
+		length += 4;
+	}
+
+	length += mod == 1 ? 1 : (mod == 2 ? 4 : 0);
+
+	return length <= size ? length : 0;
+}
+
+x86_decoder::operand x86_decoder::get_modrm_operand(const uint8_t *p, const char *const *names)
+{
+	static const char *const reg32[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"};
+
+	uint8_t mod = p[0] >> 6, rm = p[0] & 7;
+
+	if (mod == 3)
+	{
+		return {operand::operand_reg, names[rm], nullptr, 1, 0, 0};
+	}
+
+	operand memory = {operand::operand_mem, reg32[rm], nullptr, 1, 0, 0};
+	size_t n = 1;
+	bool displacement32 = mod == 2;
+
+	if (rm == 4)
+	{
+		uint8_t sib = p[1];
+		n = 2;
+
+		memory.reg = reg32[sib & 7];
+		memory.index = ((sib >> 3) & 7) == 4 ? nullptr : reg32[(sib >> 3) & 7];
+		memory.scale = 1u << (sib >> 6);
+
+		if (mod == 0 && (sib & 7) == 5)
+		{
+			memory.reg = nullptr;
+			displacement32 = true;
+		}
+	}
+	else if (mod == 0 && rm == 5)
+	{
+		memory.reg = nullptr;
+		displacement32 = true;
+	}
+
+	if (displacement32)
+	{
+		int32_t disp = 0;
+		memcpy(&disp, p + n, sizeof(disp));
+		memory.disp = disp;
+	}
+	else if (mod == 1)
+	{
+		memory.disp = static_cast<int8_t>(p[n]);
+	}
+
+	return memory;
+}
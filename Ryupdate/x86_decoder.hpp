@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+//decoder for the common 32-bit forms, reported the way capstone does, the rest is left to capstone
+class x86_decoder
+{
+public:
+	struct operand
+	{
+		enum operand_type : uint32_t
+		{
+			operand_reg,
+			operand_imm,
+			operand_mem,
+
+			//floating point and other operands only capstone reports
+			operand_other
+		};
+
+		operand_type type;
+
+		//register name in lower case, base of memory operands, nullptr without one
+		const char *reg;
+		const char *index;
+		uint32_t scale;
+
+		//sign extended like capstone does
+		int64_t imm;
+		int64_t disp;
+	};
+
+	struct instruction
+	{
+		uint32_t address;
+		size_t length;
+
+		const char *mnemonic;
+		operand operands[3];
+		size_t op_count;
+	};
+
+	//sizes are 0 without the field
+	struct fields
+	{
+		size_t length;
+		size_t displacement_offset;
+		size_t displacement_size;
+		size_t immediate_offset;
+		size_t immediate_size;
+	};
+
+	//forms left to capstone included, 0 for wait and invalid encodings
+	static size_t get_length(const uint8_t *p, size_t size);
+
+	//false for forms left to capstone
+	static bool decode(const uint8_t *p, size_t size, uint32_t address, instruction &decoded);
+
+	//any form get_length measures, false behind 67 and for fs and gs
+	static bool get_memory_operand(const uint8_t *p, size_t size, operand &memory);
+
+	//any form get_length measures, moffs are reported as displacements
+	static bool get_fields(const uint8_t *p, size_t size, fields &found);
+
+private:
+	enum : uint8_t
+	{
+		flag_modrm = 1,
+		flag_imm8 = 2,
+		flag_imm16 = 4,
+
+		//4 bytes, 2 behind an operand size prefix
+		flag_immz = 8,
+
+		//memory offset, 4 bytes, 2 behind an address size prefix
+		flag_imm32 = 16,
+
+		//not covered, capstone decodes it
+		flag_other = 32,
+		flag_prefix = 64,
+
+		//modrm byte that always names registers, whatever its mod
+		flag_register = 128
+	};
+
+	//where get_length found the modrm byte and the immediates
+	struct parts
+	{
+		uint8_t flags;
+		size_t modrm;
+		size_t immediate;
+		bool address_size;
+	};
+
+	static size_t get_length(const uint8_t *p, size_t size, parts &found);
+
+	//modrm with sib and displacement, 0 if it does not fit
+	static size_t get_modrm_length(const uint8_t *p, size_t size, bool address_size = false);
+
+	//memory or register operand of the modrm byte at p, registers named from names
+	static operand get_modrm_operand(const uint8_t *p, const char *const *names);
+};
@@ -0,0 +1,149 @@
+#include "xref_index.hpp"
+#include "x86_decoder.hpp"
+
+#include <algorithm>
+#include <thread>
+
+xref_index::xref_index()
+{
+	offsets.push_back(0);
+}
+
+xref_index::xref_index(const uint8_t *base, size_t size, const pe_image &image, const boundary_map &boundaries)
+{
+	//the chunks of the boundary map, one thread each
+	const size_t chunk_size = 0x40000;
+
+	std::vector<std::pair<size_t, size_t>> chunks;
+	for (const pe_image::section &s : image.get_sections())
+	{
+		size_t first = s.virtual_address, last = std::min(static_cast<size_t>(s.virtual_address) + s.virtual_size, size);
+		for (size_t n = first; s.executable && n < last; n += chunk_size)
+		{
+			chunks.push_back(std::make_pair(n, std::min(n + chunk_size, last)));
+		}
+	}
+
+	std::vector<std::vector<reference>> collected(chunks.size());
+
+	size_t thread_count = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), chunks.size()));
+	std::vector<std::thread> threads;
+
+	for (size_t t = 0; t < thread_count; ++t)
+	{
+		threads.push_back(std::thread([&, t]() {
+			for (size_t k = t; k < chunks.size(); k += thread_count)
+			{
+				collected.at(k) = collect(base, size, chunks.at(k).first, chunks.at(k).second, boundaries);
+			}
+		}));
+	}
+
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+
+	std::vector<reference> references;
+	for (const std::vector<reference> &chunk : collected)
+	{
+		references.insert(references.end(), chunk.begin(), chunk.end());
+	}
+
+	std::sort(references.begin(), references.end(), [](const reference &a, const reference &b) { return a.target < b.target || (a.target == b.target && a.source < b.source); });
+
+	for (const reference &r : references)
+	{
+		if (targets.empty() || targets.back() != r.target)
+		{
+			targets.push_back(r.target);
+			offsets.push_back(static_cast<uint32_t>(sources.size()));
+		}
+
+		sources.push_back(r.source);
+	}
+
+	offsets.push_back(static_cast<uint32_t>(sources.size()));
+}
+
+xref_index::~xref_index()
+{
+}
+
+std::vector<uint32_t> xref_index::get_sources(size_t target) const
+{
+	auto it = std::lower_bound(targets.begin(), targets.end(), target, [](uint32_t value, size_t t) { return value < t; });
+	if (it == targets.end() || *it != target)
+	{
+		return std::vector<uint32_t>();
+	}
+
+	size_t n = static_cast<size_t>(it - targets.begin());
+	return std::vector<uint32_t>(sources.begin() + offsets.at(n), sources.begin() + offsets.at(n + 1));
+}
+
+size_t xref_index::get_target_count() const
+{
+	return targets.size();
+}
+
+std::vector<xref_index::reference> xref_index::collect(const uint8_t *base, size_t size, size_t first, size_t last, const boundary_map &boundaries)
+{
+	uint32_t image_address = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(base));
+	std::vector<reference> references;
+
+	for (size_t n = first; n < last; ++n)
+	{
+		if (!boundaries.is_boundary(n))
+		{
+			continue;
+		}
+
+		//forms left to capstone still name their absolute memory operand
+		x86_decoder::instruction decoded = {};
+		if (!x86_decoder::decode(base + n, size - n, static_cast<uint32_t>(n), decoded))
+		{
+			x86_decoder::operand memory = {};
+			if (x86_decoder::get_memory_operand(base + n, size - n, memory) && memory.reg == nullptr && memory.index == nullptr)
+			{
+				uint32_t target = static_cast<uint32_t>(memory.disp) - image_address;
+				if (target < size)
+				{
+					references.push_back({target, static_cast<uint32_t>(n)});
+				}
+			}
+
+			continue;
+		}
+
+		//decoded at its offset, branch targets come out as offsets
+		uint8_t opcode = base[n];
+		bool branch = opcode == 0xE8 || opcode == 0xE9 || opcode == 0xEB || (opcode >= 0x70 && opcode <= 0x7F) || (opcode == 0x0F && (base[n + 1] & 0xF0) == 0x80);
+
+		for (size_t k = 0; k < decoded.op_count; ++k)
+		{
+			const x86_decoder::operand &operand = decoded.operands[k];
+
+			uint32_t target = 0;
+			if (operand.type == x86_decoder::operand::operand_imm)
+			{
+				target = branch ? static_cast<uint32_t>(operand.imm) : static_cast<uint32_t>(operand.imm) - image_address;
+			}
+			else if (operand.type == x86_decoder::operand::operand_mem && operand.reg == nullptr && operand.index == nullptr)
+			{
+				target = static_cast<uint32_t>(operand.disp) - image_address;
+			}
+			else
+			{
+				continue;
+			}
+
+			if (target < size)
+			{
+				references.push_back({static_cast<uint32_t>(target), static_cast<uint32_t>(n)});
+			}
+		}
+	}
+
+	return references;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "pe_image.hpp"
+#include "boundary_map.hpp"
+
+#include <cstdint>
+#include <vector>
+
+//instructions referencing each call, jump, absolute memory and immediate target
+class xref_index
+{
+public:
+	xref_index();
+
+	//absolute references are made against base
+	xref_index(const uint8_t *base, size_t size, const pe_image &image, const boundary_map &boundaries);
+
+	~xref_index();
+
+	//instructions referencing target, sorted by offset
+	std::vector<uint32_t> get_sources(size_t target) const;
+
+	size_t get_target_count() const;
+
+private:
+	struct reference
+	{
+		uint32_t target;
+		uint32_t source;
+	};
+
+	//references of the instructions starting in [first, last)
+	static std::vector<reference> collect(const uint8_t *base, size_t size, size_t first, size_t last, const boundary_map &boundaries);
+
+	//sources of targets[n] are sources[offsets[n]] to sources[offsets[n + 1]]
+	std::vector<uint32_t> targets;
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> sources;
+};
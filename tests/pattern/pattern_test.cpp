@@ -0,0 +1,195 @@
+//differential test of pattern against per-position matching, random signatures of every form the parser accepts are
+//scanned over random data of a few byte values, so each has hits, and find_all has to return what the scalar path
+//and a plain value and mask compare return, cut off at any limit
+#include "../../Ryupdate/pattern.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::string to_byte(uint32_t value)
+{
+	char buffer[8];
+	snprintf(buffer, sizeof(buffer), "%02X", value & 0xFF);
+	return buffer;
+}
+
+//bytes, wildcards, nibbles and masked bytes, compiled to the value and mask compare
+static std::string generate_plain(std::mt19937 &random)
+{
+	std::string signature;
+
+	for (size_t n = 0, length = 1 + random() % 24; n < length; ++n)
+	{
+		uint32_t value = random() % 6;
+
+		switch (random() % 6)
+		{
+		case 0:
+			signature += "??";
+			break;
+
+		case 1:
+			signature += "0?";
+			break;
+
+		case 2:
+			signature += "?" + to_byte(value).substr(1);
+			break;
+
+		case 3:
+			signature += to_byte(value) + "&" + to_byte(0xFC | random() % 4);
+			break;
+
+		default:
+			signature += to_byte(value);
+			break;
+		}
+
+		signature += ' ';
+	}
+
+	return signature;
+}
+
+//ranges, sets, bounded gaps and alternatives, compiled to the automaton
+static std::string generate_extended(std::mt19937 &random)
+{
+	std::string signature;
+
+	for (size_t n = 0, length = 2 + random() % 8; n < length; ++n)
+	{
+		uint32_t value = random() % 6;
+
+		switch (random() % 7)
+		{
+		case 0:
+			signature += to_byte(value) + "-" + to_byte(value + 1 + random() % 3);
+			break;
+
+		case 1:
+			signature += "{" + to_byte(value) + " " + to_byte(random() % 6) + "}";
+			break;
+
+		case 2:
+			signature += "{^" + to_byte(value) + "}";
+			break;
+
+		case 3:
+			//a gap can neither start nor end a signature
+			if (n != 0 && n + 1 != length)
+			{
+				uint32_t low = random() % 4;
+				signature += "[" + std::to_string(low) + "-" + std::to_string(low + 1 + random() % 6) + "]";
+			}
+			else
+			{
+				signature += to_byte(value);
+			}
+			break;
+
+		case 4:
+			signature += "(" + to_byte(value) + " " + to_byte(random() % 6) + " | " + to_byte(random() % 6) + ")";
+			break;
+
+		default:
+			signature += to_byte(value);
+			break;
+		}
+
+		signature += ' ';
+	}
+
+	return signature;
+}
+
+//gaps longer than 64 bytes whose length varies, split into parts found in one sweep
+static std::string generate_parts(std::mt19937 &random)
+{
+	uint32_t first = random() % 3, second = random() % 40;
+
+	return to_byte(random() % 6) + " " + to_byte(random() % 6) + " [" + std::to_string(first) + "-" + std::to_string(first + 65 + random() % 100) + "] " +
+		   to_byte(random() % 6) + " " + to_byte(random() % 6) + " [" + std::to_string(second) + "-" + std::to_string(second + 65 + random() % 60) + "] " +
+		   to_byte(random() % 6) + " " + to_byte(random() % 6);
+}
+
+static std::vector<const uint8_t *> find_all_plain(const pattern &compiled, const uint8_t *begin, const uint8_t *end)
+{
+	std::vector<const uint8_t *> hits;
+	const std::vector<uint8_t> &bytes = compiled.get_bytes();
+	const std::vector<uint8_t> &mask = compiled.get_mask();
+
+	for (const uint8_t *p = begin; static_cast<size_t>(end - p) >= bytes.size(); ++p)
+	{
+		size_t n = 0;
+		for (; n < bytes.size() && (p[n] & mask.at(n)) == bytes.at(n); ++n);
+
+		if (n == bytes.size())
+		{
+			hits.push_back(p);
+		}
+	}
+
+	return hits;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t seed = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 1;
+	std::mt19937 random(seed);
+
+	size_t compared[3] = {0, 0, 0}, hits = 0, rejected = 0, mismatches = 0;
+
+	for (size_t round = 0; round < 900; ++round)
+	{
+		std::vector<uint8_t> data(4000 + random() % 16000);
+		for (uint8_t &b : data)
+		{
+			b = static_cast<uint8_t>(random() % 6);
+		}
+
+		size_t kind = round % 3;
+		std::string signature = kind == 0 ? generate_plain(random) : (kind == 1 ? generate_extended(random) : generate_parts(random));
+
+		try
+		{
+			pattern compiled(signature);
+
+			//unaligned starts, the vector compares must not read in front of begin
+			const uint8_t *begin = data.data() + random() % 16;
+			const uint8_t *end = data.data() + data.size();
+
+			std::vector<const uint8_t *> found = compiled.find_all(begin, end);
+			std::vector<const uint8_t *> expected = compiled.find_all_scalar(begin, end);
+
+			bool matched = found == expected && (compiled.is_extended() || found == find_all_plain(compiled, begin, end));
+
+			size_t limit = 1 + random() % 8;
+			std::vector<const uint8_t *> limited = compiled.find_all(begin, end, limit);
+			matched = matched && limited.size() == std::min(limit, found.size()) && std::equal(limited.begin(), limited.end(), found.begin());
+
+			//normalized signatures parse back into themselves
+			matched = matched && pattern(compiled.get_pattern()).get_pattern() == compiled.get_pattern();
+
+			++compared[kind];
+			hits += found.size();
+
+			if (!matched && mismatches++ < 20)
+			{
+				printf("%s (%s): %zu hits, scalar %zu\n", signature.c_str(), compiled.get_pattern().c_str(), found.size(), expected.size());
+			}
+		}
+		catch (std::invalid_argument &)
+		{
+			++rejected;
+		}
+	}
+
+	printf("%zu plain, %zu extended and %zu multi-part signatures compared, %zu hits, %zu rejected, %zu mismatches\n",
+		compared[0], compared[1], compared[2], hits, rejected, mismatches);
+
+	return mismatches == 0 && compared[0] != 0 && compared[1] != 0 && compared[2] != 0 ? 0 : 1;
+}
@@ -0,0 +1,353 @@
+//differential test of x86_decoder against objdump, every instruction objdump finds in a random corpus of the
+//common opcodes has to get the same length, the same operands where the decoder reports them and the same
+//absolute memory operand, found for the forms left to capstone as well, and the fields get_fields reports have to hold them
+#include "../../Ryupdate/x86_decoder.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+struct listed_instruction
+{
+	uint32_t offset;
+	size_t length;
+	std::string text;
+};
+
+static std::vector<uint8_t> generate_corpus(uint32_t seed)
+{
+	//opcodes the decoder covers and the prefixes and escapes it leaves to capstone, mixed with random bytes
+	static const uint8_t common[] = {
+		0x8B, 0x89, 0x8D, 0xE8, 0xE9, 0xEB, 0x74, 0x75, 0x3B, 0x39, 0x83, 0x81, 0xFF, 0x50, 0x55, 0x68, 0x6A, 0xC7, 0xA1,
+		0xA3, 0xB8, 0x0F, 0x85, 0x33, 0x03, 0x2B, 0xC3, 0xC2, 0x66, 0xF3, 0x64, 0x3D, 0xF6, 0xF7, 0xC1, 0xD9, 0xDD,
+		0x67, 0xC4, 0xC5, 0x62, 0x9A, 0xEA, 0xC8, 0xA0, 0xA2, 0x80, 0xC6
+	};
+
+	std::mt19937 random(seed);
+	std::vector<uint8_t> corpus;
+
+	for (size_t n = 0; n < 200000; ++n)
+	{
+		corpus.push_back(random() % 3 ? common[random() % sizeof(common)] : static_cast<uint8_t>(random()));
+		for (size_t k = 0; k < 7; ++k)
+		{
+			corpus.push_back(static_cast<uint8_t>(random()));
+		}
+	}
+
+	return corpus;
+}
+
+//"  offset:\tbytes\ttext" lines of objdump -D, long instructions continue on lines without text
+static std::vector<listed_instruction> list_instructions(const std::string &objdump, const std::string &path)
+{
+	std::vector<listed_instruction> listed;
+
+	std::string command = objdump + " -D -b binary -m i386 -M intel " + path;
+	FILE *pipe = popen(command.c_str(), "r");
+	if (pipe == nullptr)
+	{
+		return listed;
+	}
+
+	char line[512];
+	while (fgets(line, sizeof(line), pipe))
+	{
+		std::string text(line);
+		while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+		{
+			text.pop_back();
+		}
+
+		size_t colon = text.find(":\t");
+		if (colon == std::string::npos || text.find_first_not_of(" 0123456789abcdef") != colon)
+		{
+			continue;
+		}
+
+		size_t tab = text.find('\t', colon + 2);
+		std::string bytes = text.substr(colon + 2, tab == std::string::npos ? std::string::npos : tab - colon - 2);
+		size_t length = 0;
+		for (size_t n = 0; n < bytes.size(); ++n)
+		{
+			length += bytes.at(n) != ' ' && (n == 0 || bytes.at(n - 1) == ' ');
+		}
+
+		if (tab == std::string::npos)
+		{
+			if (!listed.empty())
+			{
+				listed.back().length += length;
+			}
+
+			continue;
+		}
+
+		listed.push_back({static_cast<uint32_t>(std::stoul(text.substr(0, colon), nullptr, 16)), length, text.substr(tab + 1)});
+	}
+
+	pclose(pipe);
+	return listed;
+}
+
+static std::string to_hexadecimal(uint64_t value)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(value));
+	return buffer;
+}
+
+//objdump's intel syntax without sizes, symbols, eiz and zero displacements, absolute addresses as ds:address
+static std::string normalize(const std::string &text)
+{
+	static const std::regex spaces("\\s+");
+	static const std::regex sizes("(BYTE|WORD|DWORD|QWORD|TBYTE|FWORD) PTR ");
+	static const std::regex symbol(" <.*>");
+	static const std::regex inner_eiz("\\+eiz\\*\\d");
+	static const std::regex leading_eiz("\\[eiz\\*\\d\\+?");
+	static const std::regex absolute("\\[(-?)0x([0-9a-f]+)\\]");
+
+	std::string normalized = std::regex_replace(text, spaces, " ");
+	normalized = std::regex_replace(normalized, sizes, "");
+	normalized = std::regex_replace(normalized, symbol, "");
+	normalized = std::regex_replace(normalized, inner_eiz, "");
+	normalized = std::regex_replace(normalized, leading_eiz, "[");
+
+	for (size_t n; (n = normalized.find("+0x0]")) != std::string::npos;)
+	{
+		normalized.replace(n, 5, "]");
+	}
+
+	std::smatch match;
+	while (std::regex_search(normalized, match, absolute))
+	{
+		uint32_t value = static_cast<uint32_t>(std::stoull(match[2].str(), nullptr, 16));
+		normalized.replace(match.position(0), match.length(0), "ds:" + to_hexadecimal(match[1].length() ? 0 - value : value));
+	}
+
+	while (!normalized.empty() && normalized.back() == ' ')
+	{
+		normalized.pop_back();
+	}
+
+	return normalized;
+}
+
+static std::string format(const x86_decoder::instruction &decoded)
+{
+	std::string text = decoded.mnemonic;
+
+	for (size_t n = 0; n < decoded.op_count; ++n)
+	{
+		const x86_decoder::operand &operand = decoded.operands[n];
+		std::string formatted;
+
+		if (operand.type == x86_decoder::operand::operand_reg)
+		{
+			formatted = operand.reg;
+		}
+		else if (operand.type == x86_decoder::operand::operand_imm)
+		{
+			formatted = to_hexadecimal(static_cast<uint32_t>(operand.imm));
+		}
+		else if (operand.reg == nullptr && operand.index == nullptr)
+		{
+			formatted = "ds:" + to_hexadecimal(static_cast<uint32_t>(operand.disp));
+		}
+		else
+		{
+			formatted = "[";
+			if (operand.reg != nullptr)
+			{
+				formatted += operand.reg;
+			}
+
+			if (operand.index != nullptr)
+			{
+				formatted += std::string(operand.reg != nullptr ? "+" : "") + operand.index + "*" + std::to_string(operand.scale);
+			}
+
+			if (operand.disp > 0)
+			{
+				formatted += "+" + to_hexadecimal(operand.disp);
+			}
+			else if (operand.disp < 0)
+			{
+				formatted += "-" + to_hexadecimal(-operand.disp);
+			}
+
+			formatted += "]";
+		}
+
+		text += (n == 0 ? " " : ",") + formatted;
+	}
+
+	return text;
+}
+
+static int64_t read_field(const uint8_t *p, size_t size)
+{
+	int64_t value = 0;
+	if (size == 1)
+	{
+		value = static_cast<int8_t>(p[0]);
+	}
+	else if (size == 2)
+	{
+		value = static_cast<int16_t>(p[0] | (p[1] << 8));
+	}
+	else if (size == 4)
+	{
+		int32_t field = 0;
+		memcpy(&field, p, sizeof(field));
+		value = field;
+	}
+
+	return value;
+}
+
+//the displacement and immediate fields have to hold what decode reports, branch targets relative to the next instruction
+static bool check_fields(const uint8_t *p, size_t size, const x86_decoder::instruction &decoded)
+{
+	x86_decoder::fields found = {};
+	if (!x86_decoder::get_fields(p, size, found) || found.length != decoded.length)
+	{
+		return false;
+	}
+
+	for (size_t n = 0; n < decoded.op_count; ++n)
+	{
+		const x86_decoder::operand &operand = decoded.operands[n];
+
+		if (operand.type == x86_decoder::operand::operand_mem && read_field(p + found.displacement_offset, found.displacement_size) != operand.disp)
+		{
+			return false;
+		}
+
+		if (operand.type == x86_decoder::operand::operand_imm)
+		{
+			int64_t immediate = read_field(p + found.immediate_offset, found.immediate_size);
+			bool relative = static_cast<uint32_t>(decoded.address + decoded.length + immediate) == static_cast<uint32_t>(operand.imm);
+
+			//ret's word is unsigned
+			if (!relative && immediate != operand.imm && (immediate & 0xFFFF) != operand.imm)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	std::string objdump = argc > 1 ? argv[1] : "objdump";
+	uint32_t seed = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 1;
+	std::string path = "x86_decoder_test_" + std::to_string(seed) + ".bin";
+
+	std::vector<uint8_t> corpus = generate_corpus(seed);
+
+	FILE *file = fopen(path.c_str(), "wb");
+	if (file == nullptr || fwrite(corpus.data(), 1, corpus.size(), file) != corpus.size())
+	{
+		fprintf(stderr, "cannot write %s\n", path.c_str());
+		return 1;
+	}
+	fclose(file);
+
+	std::vector<listed_instruction> listed = list_instructions(objdump, path);
+	if (listed.empty())
+	{
+		fprintf(stderr, "%s listed no instructions\n", objdump.c_str());
+		return 1;
+	}
+
+	//absolute operands under any segment but fs and gs, which do not address the image
+	static const std::regex absolute("(cs|ds|es|ss):0x([0-9a-f]+)");
+	static const uint8_t prefixes[] = {0x26, 0x2E, 0x36, 0x3E, 0x64, 0x65, 0x66, 0x67, 0xF0, 0xF2, 0xF3};
+
+	size_t covered = 0, decoded_count = 0, absolute_count = 0, length_mismatches = 0, operand_mismatches = 0, absolute_mismatches = 0, field_mismatches = 0;
+
+	for (const listed_instruction &expected : listed)
+	{
+		if (expected.text.find("(bad)") != std::string::npos)
+		{
+			continue;
+		}
+
+		const uint8_t *p = corpus.data() + expected.offset;
+		size_t size = corpus.size() - expected.offset;
+
+		size_t length = x86_decoder::get_length(p, size);
+		if (length != 0)
+		{
+			++covered;
+
+			if (length != expected.length && length_mismatches++ < 20)
+			{
+				printf("length %08X: %zu, objdump %zu %s\n", expected.offset, length, expected.length, expected.text.c_str());
+			}
+		}
+
+		std::string normalized = normalize(expected.text);
+
+		x86_decoder::instruction decoded = {};
+		if (x86_decoder::decode(p, size, expected.offset, decoded))
+		{
+			++decoded_count;
+
+			std::string text = format(decoded);
+			if (text != normalized && operand_mismatches++ < 20)
+			{
+				printf("operands %08X: %s, objdump %s\n", expected.offset, text.c_str(), normalized.c_str());
+			}
+
+			if (!check_fields(p, size, decoded) && field_mismatches++ < 20)
+			{
+				printf("fields %08X: %s\n", expected.offset, text.c_str());
+			}
+		}
+
+		//fs, gs and 16-bit addresses are left out
+		bool excluded = length == 0;
+		for (size_t n = 0; n < length && memchr(prefixes, p[n], sizeof(prefixes)); ++n)
+		{
+			excluded = excluded || p[n] == 0x64 || p[n] == 0x65 || p[n] == 0x67;
+		}
+
+		if (excluded)
+		{
+			continue;
+		}
+
+		x86_decoder::operand memory = {};
+		bool found = x86_decoder::get_memory_operand(p, size, memory) && memory.reg == nullptr && memory.index == nullptr;
+
+		std::smatch match;
+		bool listed_absolute = std::regex_search(normalized, match, absolute);
+		absolute_count += listed_absolute;
+
+		if ((found != listed_absolute || (found && static_cast<uint32_t>(memory.disp) != std::stoull(match[2].str(), nullptr, 16))) && absolute_mismatches++ < 20)
+		{
+			printf("absolute %08X: %s, objdump %s\n", expected.offset, found ? to_hexadecimal(static_cast<uint32_t>(memory.disp)).c_str() : "none", normalized.c_str());
+		}
+
+		//absolute operands of every form sit in a 4 byte displacement field
+		x86_decoder::fields fields = {};
+		if (found && (!x86_decoder::get_fields(p, size, fields) || fields.displacement_size != 4 || read_field(p + fields.displacement_offset, 4) != memory.disp) && field_mismatches++ < 20)
+		{
+			printf("fields %08X: %s\n", expected.offset, normalized.c_str());
+		}
+	}
+
+	printf("%zu instructions, %zu lengths, %zu operands and %zu absolute operands compared, %zu, %zu, %zu and %zu field mismatches\n",
+		listed.size(), covered, decoded_count, absolute_count, length_mismatches, operand_mismatches, absolute_mismatches, field_mismatches);
+
+	remove(path.c_str());
+	return length_mismatches == 0 && operand_mismatches == 0 && absolute_mismatches == 0 && field_mismatches == 0 ? 0 : 1;
+}